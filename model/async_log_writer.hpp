@@ -0,0 +1,312 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PANDEMIC_HOYA_2002_ASYNC_LOG_WRITER_HPP
+#define PANDEMIC_HOYA_2002_ASYNC_LOG_WRITER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <initializer_list>
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+
+/**
+ * Log sink that moves disk I/O off the simulation thread.
+ * The simulation thread appends formatted records into one of a fixed pool of buffers.
+ * Full buffers are handed to a writer thread that dumps them to disk with large sequential writes.
+ * Memory is bounded by n_buffers * buffer_size: when every buffer is waiting for the disk, the simulation
+ * thread blocks until one is released (back-pressure).
+ */
+class async_log_writer {
+    /// Stream buffer that fills the current buffer of the pool without taking any lock
+    class pool_streambuf : public std::streambuf {
+        async_log_writer &writer;
+    public:
+        explicit pool_streambuf(async_log_writer &w) : writer(w) {}
+
+        void reset(char *begin, std::size_t size) {
+            setp(begin, begin + size);
+        }
+
+        void advance(std::size_t n) {
+            pbump((int) n);
+        }
+
+        [[nodiscard]] std::size_t used() const {
+            return pptr() - pbase();
+        }
+
+    protected:
+        int_type overflow(int_type c) override {
+            writer.swap_buffer();
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char *s, std::streamsize n) override {
+            std::streamsize written = 0;
+            while (written < n) {
+                if (pptr() == epptr()) {
+                    writer.swap_buffer();
+                }
+                std::streamsize chunk = std::min<std::streamsize>(n - written, epptr() - pptr());
+                std::memcpy(pptr(), s + written, chunk);
+                pbump((int) chunk);
+                written += chunk;
+            }
+            return written;
+        }
+
+        // std::endl ends every log record. Records are only published for emergency flushes: disk writes wait for a full buffer
+        int sync() override {
+            writer.committed.store(used(), std::memory_order_release);
+            return 0;
+        }
+    };
+
+    struct chunk {
+        std::size_t buffer;
+        std::size_t size;
+    };
+
+    std::string file_path;
+    std::FILE *file;
+    std::vector<std::vector<char>> buffers;
+    std::deque<std::size_t> free_buffers;
+    std::deque<chunk> pending;
+    std::size_t current;
+    std::atomic<std::size_t> committed;  // bytes of the current buffer that hold complete records
+    bool current_queued;  // the current buffer was handed to the writer thread, which now owns it
+    bool writing;
+    bool stopping;
+    bool frozen;
+
+    std::mutex mutex;
+    std::condition_variable buffer_released;
+    std::condition_variable chunk_ready;
+    pool_streambuf streambuf;
+    std::ostream out;
+    std::thread writer_thread;
+
+    static std::mutex &registry_mutex() {
+        static std::mutex m;
+        return m;
+    }
+
+    static std::vector<async_log_writer *> &registry() {
+        static std::vector<async_log_writer *> writers;
+        return writers;
+    }
+
+    /**
+     * Hands the complete records of the current buffer to the writer thread and waits for an empty one.
+     * The record being written moves to the new buffer, so chunks always end with a complete record
+     * (unless a single record does not fit in a buffer). Only called by the simulation thread
+     */
+    void swap_buffer() {
+        std::unique_lock<std::mutex> lock(mutex);
+        buffer_released.wait(lock, [this] { return !frozen; });
+        std::size_t used = streambuf.used();
+        std::size_t complete = committed.load(std::memory_order_relaxed);
+        if (complete == 0) {
+            complete = used;  // the record is larger than a whole buffer: it is written in pieces
+        }
+        std::string partial(buffers[current].data() + complete, buffers[current].data() + used);
+        pending.push_back({current, complete});
+        current_queued = true;
+        chunk_ready.notify_one();
+        buffer_released.wait(lock, [this] { return !free_buffers.empty() && !frozen; });
+        acquire_buffer();
+        std::memcpy(buffers[current].data(), partial.data(), partial.size());
+        streambuf.advance(partial.size());
+    }
+
+    /// Takes an empty buffer as the current buffer. Mutex must be held by the caller
+    void acquire_buffer() {
+        current = free_buffers.front();
+        free_buffers.pop_front();
+        current_queued = false;
+        committed.store(0, std::memory_order_release);
+        streambuf.reset(buffers[current].data(), buffers[current].size());
+    }
+
+    void write_loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            chunk_ready.wait(lock, [this] { return !pending.empty() || stopping; });
+            if (pending.empty()) {
+                return;
+            }
+            chunk next = pending.front();
+            pending.pop_front();
+            writing = true;
+            lock.unlock();
+            if (file != nullptr && next.size > 0) {
+                std::fwrite(buffers[next.buffer].data(), 1, next.size, file);
+            }
+            lock.lock();
+            writing = false;
+            free_buffers.push_back(next.buffer);
+            buffer_released.notify_all();
+        }
+    }
+
+    /// Blocks until the writer thread has nothing left to write. Mutex must be held by the caller
+    void wait_drained(std::unique_lock<std::mutex> &lock) {
+        buffer_released.wait(lock, [this] { return pending.empty() && !writing; });
+    }
+
+    /**
+     * Writes every complete record that reached the writer and closes the file. Called from the signal watcher.
+     * Buffers already handed to the writer thread are written as they are; the current buffer, if the simulation
+     * thread still owns it, is truncated after its last complete record.
+     */
+    void emergency_flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        frozen = true;
+        if (!current_queued) {
+            pending.push_back({current, committed.load(std::memory_order_acquire)});
+            current_queued = true;
+        }
+        chunk_ready.notify_one();
+        wait_drained(lock);
+        if (file != nullptr) {
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+public:
+    explicit async_log_writer(std::string path, std::size_t buffer_size = 1 << 22, std::size_t n_buffers = 4):
+            file_path(std::move(path)), file(std::fopen(file_path.c_str(), "wb")),
+            buffers(std::max<std::size_t>(n_buffers, 2), std::vector<char>(buffer_size)), current(0), committed(0),
+            current_queued(false), writing(false), stopping(false), frozen(false), streambuf(*this), out(&streambuf) {
+        if (file == nullptr) {
+            std::cerr << "Unable to open log file " << file_path << ". Its records will be discarded" << std::endl;
+        } else {
+            std::setvbuf(file, nullptr, _IONBF, 0);  // we already hand whole buffers to the OS
+        }
+        for (std::size_t i = 1; i < buffers.size(); i++) {
+            free_buffers.push_back(i);
+        }
+        streambuf.reset(buffers[current].data(), buffers[current].size());
+
+        // The writer thread must never handle termination signals: they are caught by the signal watcher
+        sigset_t blocked, previous;
+        sigfillset(&blocked);
+        pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+        writer_thread = std::thread(&async_log_writer::write_loop, this);
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        registry().push_back(this);
+    }
+
+    async_log_writer(async_log_writer const &) = delete;
+    async_log_writer &operator = (async_log_writer const &) = delete;
+
+    ~async_log_writer() {
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex());
+            auto &writers = registry();
+            writers.erase(std::remove(writers.begin(), writers.end(), this), writers.end());
+        }
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        chunk_ready.notify_one();
+        writer_thread.join();
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+    }
+
+    [[nodiscard]] std::ostream &stream() {
+        return out;
+    }
+
+    /// Writes every record appended so far to disk. Blocks the calling thread until done
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (frozen) {
+            return;
+        }
+        if (streambuf.used() > 0) {
+            pending.push_back({current, streambuf.used()});
+            current_queued = true;
+            chunk_ready.notify_one();
+            buffer_released.wait(lock, [this] { return !free_buffers.empty(); });
+            acquire_buffer();
+        }
+        wait_drained(lock);
+        if (file != nullptr) {
+            std::fflush(file);
+        }
+    }
+
+    /**
+     * Flushes every log writer before the process dies from one of the given signals.
+     * It must be called from the main thread before any other thread is spawned: signals are blocked
+     * and handled synchronously by a watcher thread, so no I/O happens inside a signal handler.
+     * @param signals signals that terminate the simulation (e.g., SIGINT and SIGTERM).
+     */
+    static void flush_on_signals(std::initializer_list<int> signals) {
+        static sigset_t watched;
+        sigemptyset(&watched);
+        for (int signal: signals) {
+            sigaddset(&watched, signal);
+        }
+        pthread_sigmask(SIG_BLOCK, &watched, nullptr);
+        std::thread([] {
+            int signal = 0;
+            sigwait(&watched, &signal);
+            std::lock_guard<std::mutex> lock(registry_mutex());
+            for (auto *writer: registry()) {
+                writer->emergency_flush();
+            }
+            std::_Exit(128 + signal);
+        }).detach();
+    }
+};
+
+#endif //PANDEMIC_HOYA_2002_ASYNC_LOG_WRITER_HPP
@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <iostream>
+#include "calibration.hpp"
+
+using namespace std;
+
+using TIME = float;
+
+int main(int argc, char ** argv) {
+    if (argc < 2) {
+        cout << "Program used with wrong parameters. The program must be invoked as follows:" << endl;
+        cout << argv[0] << " CALIBRATION_CONFIG.json [OUTPUT_CONFIG.json]" << endl;
+        return -1;
+    }
+    std::ifstream i(argv[1]);
+    nlohmann::json j;
+    i >> j;
+    calibration<TIME> calibration(j.get<calibration_config>());
+
+    auto best = calibration.run([](unsigned int generation, std::vector<float> const &, double error) {
+        cout << "Generation " << generation << ": best error " << error << endl;
+    });
+    nlohmann::json fitted = calibration.fitted_config(best.first);
+    cout << "Best error: " << best.second << endl;
+    cout << "\"hoya_age\": " << fitted.dump(4) << endl;
+    if (argc > 2) {
+        std::ofstream out(argv[2]);
+        out << fitted.dump(4) << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,276 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PANDEMIC_HOYA_2002_CALIBRATION_HPP
+#define PANDEMIC_HOYA_2002_CALIBRATION_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "hoya_simulation.hpp"
+
+/// Searchable range of one parameter. age_group < 0 means that every age group shares the same value
+struct calibration_parameter {
+    std::string name;
+    int age_group;
+    float lower;
+    float upper;
+};
+
+struct calibration_config {
+    std::string scenario;
+    std::vector<float> observed_infected;
+    std::vector<float> observed_deceased;
+    std::vector<calibration_parameter> parameters;
+    unsigned int population_size;
+    unsigned int generations;
+    unsigned int threads;
+    float mutation;
+    float crossover;
+    unsigned int seed;
+
+    calibration_config(): population_size(16), generations(30), threads(0), mutation(0.6), crossover(0.9), seed(0) {}
+};
+
+/**
+ * Bounds are either one [lower, upper] pair shared by every age group, or one pair per age group:
+ * "bounds": { "recovery": [ 0.01, 0.2 ], "mortality": [ [ 0, 0.01 ], [ 0, 0.01 ], [ 0, 0.05 ], [ 0, 0.1 ] ] }
+ * Observed series are ratios of the total population, one value per time step.
+ */
+[[maybe_unused]] void from_json(const nlohmann::json& j, calibration_config &v) {
+    j.at("scenario").get_to(v.scenario);
+    auto const &observed = j.at("observed");
+    if (observed.contains("infected")) observed.at("infected").get_to(v.observed_infected);
+    if (observed.contains("deceased")) observed.at("deceased").get_to(v.observed_deceased);
+    auto range = [](std::string const &name, nlohmann::json const &pair) {
+        if (!pair.is_array() || pair.size() != 2 || !pair.at(0).is_number() || !pair.at(1).is_number() ||
+            pair.at(0).get<float>() > pair.at(1).get<float>()) {
+            throw std::invalid_argument("bounds of " + name + " must be [lower, upper] pairs");
+        }
+        return std::make_pair(pair.at(0).get<float>(), pair.at(1).get<float>());
+    };
+    for (auto const &[name, bounds]: j.at("bounds").items()) {
+        if (bounds.is_array() && !bounds.empty() && bounds.at(0).is_array()) {
+            for (int i = 0; i < (int) bounds.size(); i++) {
+                auto [lower, upper] = range(name, bounds.at(i));
+                v.parameters.push_back({name, i, lower, upper});
+            }
+        } else {
+            auto [lower, upper] = range(name, bounds);
+            v.parameters.push_back({name, -1, lower, upper});
+        }
+    }
+    if (j.contains("population_size")) j.at("population_size").get_to(v.population_size);
+    if (j.contains("generations")) j.at("generations").get_to(v.generations);
+    if (j.contains("threads")) j.at("threads").get_to(v.threads);
+    if (j.contains("mutation")) j.at("mutation").get_to(v.mutation);
+    if (j.contains("crossover")) j.at("crossover").get_to(v.crossover);
+    if (j.contains("seed")) j.at("seed").get_to(v.seed);
+}
+
+/**
+ * Fits cell parameters to observed infected/deceased curves with differential evolution (DE/rand/1/bin).
+ * Every candidate of a generation is simulated concurrently in its own thread.
+ * A candidate only replaces the population member it competes against if its error is lower.
+ * The error is a sum of squares that only grows with time, so a simulation stops as soon as it exceeds the error of that member.
+ */
+template <typename T>
+class calibration {
+    calibration_config config;
+    nlohmann::json default_config;
+    std::size_t horizon;
+    std::mt19937 rand_gen;
+
+    struct candidate {
+        std::vector<float> x;
+        double error;
+    };
+
+    [[nodiscard]] double evaluate(std::vector<float> const &x, double threshold) const {
+        hoya_simulation<T> simulation(config.scenario, patch(x));
+        double error = 0;
+        for (std::size_t time = 0; time < horizon; time++) {
+            if (time > 0) {  // observed series start with the initial state of the lattice
+                simulation.step();
+            }
+            lattice_totals totals = simulation.totals();
+            if (time < config.observed_infected.size()) {
+                double diff = totals.infected_ratio() - config.observed_infected[time];
+                error += diff * diff;
+            }
+            if (time < config.observed_deceased.size()) {
+                double diff = totals.deceased_ratio() - config.observed_deceased[time];
+                error += diff * diff;
+            }
+            if (error >= threshold) {
+                break;  // it cannot beat the threshold anymore
+            }
+        }
+        return error;
+    }
+
+    /// Simulates every candidate whose error is unknown. A candidate gives up when its error reaches its threshold
+    void evaluate_all(std::vector<candidate> &candidates, std::vector<double> const &thresholds) const {
+        unsigned int n_threads = (config.threads > 0)? config.threads : std::max(1u, std::thread::hardware_concurrency());
+        std::atomic<std::size_t> next(0);
+        auto worker = [&] {
+            for (std::size_t i = next++; i < candidates.size(); i = next++) {
+                candidates[i].error = evaluate(candidates[i].x, thresholds[i]);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < std::min<std::size_t>(n_threads, candidates.size()); t++) {
+            workers.emplace_back(worker);
+        }
+        for (auto &w: workers) {
+            w.join();
+        }
+    }
+
+public:
+    explicit calibration(calibration_config c): config(std::move(c)), rand_gen(config.seed) {
+        std::ifstream i(config.scenario);
+        nlohmann::json scenario;
+        i >> scenario;
+        default_config = scenario.at("scenario").at("default_config").at("hoya_age");
+        horizon = std::max(config.observed_infected.size(), config.observed_deceased.size());
+        if (config.parameters.empty() || horizon == 0) {
+            throw std::invalid_argument("calibration needs parameter bounds and at least one observed time series");
+        }
+        config.population_size = std::max(config.population_size, 4u);  // DE/rand/1 needs three other members
+        std::map<std::string, std::size_t> age_groups;  // number of per-age bounds of every parameter
+        for (auto const &parameter: config.parameters) {
+            if (!default_config.contains(parameter.name) || !default_config.at(parameter.name).is_array()) {
+                throw std::invalid_argument("only parameters with one value per age group can be calibrated (" +
+                                            parameter.name + ")");
+            }
+            if (parameter.age_group >= 0) {
+                age_groups[parameter.name]++;
+            }
+        }
+        for (auto const &[name, n_bounds]: age_groups) {
+            if (n_bounds != default_config.at(name).size()) {
+                throw std::invalid_argument("bounds of " + name + " must have one pair per age group (" +
+                                            std::to_string(default_config.at(name).size()) + ")");
+            }
+        }
+    }
+
+    /// Default configuration of the scenario with the parameters of a candidate
+    [[nodiscard]] nlohmann::json patch(std::vector<float> const &x) const {
+        nlohmann::json res;
+        for (std::size_t p = 0; p < config.parameters.size(); p++) {
+            auto const &parameter = config.parameters[p];
+            if (!res.contains(parameter.name)) {
+                res[parameter.name] = default_config.at(parameter.name);
+            }
+            auto &values = res[parameter.name];
+            for (int i = 0; i < (int) values.size(); i++) {
+                if (parameter.age_group < 0 || parameter.age_group == i) {
+                    values[i] = x[p];
+                }
+            }
+        }
+        return res;
+    }
+
+    /// Default configuration of the scenario with the best-fit parameters, ready to replace default_config.hoya_age
+    [[nodiscard]] nlohmann::json fitted_config(std::vector<float> const &x) const {
+        nlohmann::json res = default_config;
+        res.merge_patch(patch(x));
+        return res;
+    }
+
+    /**
+     * Runs the differential evolution.
+     * @param report function called after every generation with the generation number and the best candidate so far.
+     * @return the best parameters found and their error.
+     */
+    template <typename F>
+    std::pair<std::vector<float>, double> run(F const &report) {
+        std::size_t dims = config.parameters.size();
+        std::uniform_real_distribution<float> unit(0, 1);
+        auto random_in_bounds = [&](std::size_t d) {
+            auto const &p = config.parameters[d];
+            return p.lower + unit(rand_gen) * (p.upper - p.lower);
+        };
+
+        std::vector<candidate> population(config.population_size);
+        for (auto &member: population) {
+            for (std::size_t d = 0; d < dims; d++) {
+                member.x.push_back(random_in_bounds(d));
+            }
+        }
+        evaluate_all(population, std::vector<double>(population.size(), std::numeric_limits<double>::infinity()));
+
+        std::uniform_int_distribution<std::size_t> pick(0, population.size() - 1);
+        std::uniform_int_distribution<std::size_t> pick_dim(0, dims - 1);
+        for (unsigned int generation = 0; generation < config.generations; generation++) {
+            std::vector<candidate> trials(population.size());
+            std::vector<double> thresholds(population.size());
+            for (std::size_t i = 0; i < population.size(); i++) {
+                std::size_t a, b, c;
+                do { a = pick(rand_gen); } while (a == i);
+                do { b = pick(rand_gen); } while (b == i || b == a);
+                do { c = pick(rand_gen); } while (c == i || c == a || c == b);
+                std::size_t forced = pick_dim(rand_gen);
+                trials[i].x = population[i].x;
+                for (std::size_t d = 0; d < dims; d++) {
+                    if (d == forced || unit(rand_gen) < config.crossover) {
+                        float value = population[a].x[d] + config.mutation * (population[b].x[d] - population[c].x[d]);
+                        auto const &p = config.parameters[d];
+                        trials[i].x[d] = (value < p.lower || value > p.upper)? random_in_bounds(d) : value;
+                    }
+                }
+                thresholds[i] = population[i].error;
+            }
+            evaluate_all(trials, thresholds);
+            for (std::size_t i = 0; i < population.size(); i++) {
+                if (trials[i].error < population[i].error) {
+                    population[i] = trials[i];
+                }
+            }
+            auto best = std::min_element(population.begin(), population.end(),
+                                         [](candidate const &l, candidate const &r) { return l.error < r.error; });
+            report(generation, best->x, best->error);
+        }
+        auto best = std::min_element(population.begin(), population.end(),
+                                     [](candidate const &l, candidate const &r) { return l.error < r.error; });
+        return {best->x, best->error};
+    }
+};
+
+#endif //PANDEMIC_HOYA_2002_CALIBRATION_HPP
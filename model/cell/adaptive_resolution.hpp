@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef PANDEMIC_HOYA_2002_ADAPTIVE_RESOLUTION_HPP
+#define PANDEMIC_HOYA_2002_ADAPTIVE_RESOLUTION_HPP
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "state.hpp"
+
+/**
+ * Adaptive resolution of the lattice. The lattice is divided in square blocks of cells. A quiet block is aggregated:
+ * the first cell of the block (its leader) holds the summed population of the block and the ratios of the whole
+ * block, while the other cells (its members) are emptied and do not compute anything. The leader splits the block
+ * when its infected ratio, or the difference with the infected ratio of the cells around it, exceeds a threshold,
+ * and merges it again once every cell of the block has settled.
+ *
+ * People are handed over in two time steps, so the lattice never counts them twice: the leader announces the change
+ * and, in the next step, members take (or give) their share while the leader does the opposite.
+ */
+struct adaptive_resolution {
+    int block;                 // side of the blocks, in cells
+    float split_threshold;     // infected ratio above which an aggregated block is split
+    float merge_threshold;     // infected ratio below which every cell of a block must be to merge it
+    float gradient_threshold;  // maximum difference of infected ratio with the cells around an aggregated block
+
+    adaptive_resolution() : block(8), split_threshold(0.05), merge_threshold(0.03), gradient_threshold(0.01) {}
+
+    /// Position of the leader of the block of a cell
+    [[nodiscard]] std::vector<int> leader(std::vector<int> const &cell) const {
+        std::vector<int> res(cell);
+        for (auto &i: res) {
+            i -= i % block;
+        }
+        return res;
+    }
+
+    [[nodiscard]] bool same_block(std::vector<int> const &a, std::vector<int> const &b) const {
+        for (std::size_t dim = 0; dim < a.size(); dim++) {
+            if (a[dim] / block != b[dim] / block) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Checks that blocks can be merged again with the rounding precision of their cells. Cells round the infected
+     * ratio of each age group to multiples of 1 / precision: once the people that leave a group in a time step round
+     * to zero, the group stays infected forever. The merge threshold must exceed the sum of these residual ratios.
+     */
+    void check_rounding(std::vector<float> const &recovery, std::vector<float> const &mortality, float precision) const {
+        float residual = 0;
+        for (std::size_t i = 0; i < recovery.size(); i++) {
+            float leaving = recovery[i] + ((i < mortality.size()) ? mortality[i] : 0);
+            residual += (leaving > 0) ? 0.5f / (precision * leaving) : 1;
+        }
+        if (merge_threshold <= residual) {
+            throw std::invalid_argument("the merge threshold of adaptive resolution must exceed the infected ratio that "
+                                        "cells cannot recover from due to rounding (" + std::to_string(residual) + ")");
+        }
+    }
+
+    /// State of a member whose people are aggregated in the leader of its block
+    [[nodiscard]] static sird member_state(sird const &s) {
+        sird res = s;
+        res.population = 0;
+        res.block = block_member;
+        for (std::size_t i = 0; i < s.susceptible.size(); i++) {
+            res.susceptible[i] = res.infected[i] = res.recovered[i] = res.deceased[i] = 0;
+        }
+        return res;
+    }
+};
+
+[[maybe_unused]] void from_json(const nlohmann::json& j, adaptive_resolution &a) {
+    j.at("block").get_to(a.block);
+    j.at("split_threshold").get_to(a.split_threshold);
+    j.at("merge_threshold").get_to(a.merge_threshold);
+    j.at("gradient_threshold").get_to(a.gradient_threshold);
+    if (a.block < 1) {
+        throw std::invalid_argument("the side of adaptive resolution blocks must be positive");
+    }
+    if (a.merge_threshold > a.split_threshold) {  // merged blocks would be split again right away
+        throw std::invalid_argument("the merge threshold of adaptive resolution cannot exceed the split threshold");
+    }
+}
+
+#endif //PANDEMIC_HOYA_2002_ADAPTIVE_RESOLUTION_HPP
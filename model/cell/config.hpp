@@ -28,7 +28,11 @@
 #ifndef PANDEMIC_HOYA_2002_CONFIG_HPP
 #define PANDEMIC_HOYA_2002_CONFIG_HPP
 
+#include <memory>
+#include <random>
 #include <nlohmann/json.hpp>
+#include "region_monitor.hpp"
+#include "adaptive_resolution.hpp"
 
 struct config {
     std::vector<float> susceptibility;
@@ -59,12 +63,22 @@ struct config {
 	float rand_avg_occurence_rate;
 	float rand_seed;
 
+	int clock_offset;  // simulation time at which the cell is created (e.g., when resuming a scenario from a snapshot)
+	bool quiescent;  // when resuming a scenario, the cell keeps its state in the first step (see hoya_simulation.hpp)
+
+	// Set by the coupled model, not read from JSON
+	std::shared_ptr<std::default_random_engine> rand_gen;  // random engine of the simulation
+	std::shared_ptr<region_monitor> regions;
+	std::size_t region_cell;  // position of the cell in the region monitor
+	std::shared_ptr<const adaptive_resolution> adaptive;  // null if the lattice is always simulated at full resolution
+	sird fine_state;  // population and age groups of the cell at full resolution (only with adaptive resolution)
+
     config(): susceptibility({1.0}), virulence({0.6}), recovery({0.4}), mortality({0.03}), infected_capacity(0.1),
               over_capacity_modifier(1.5), mask_use({1.0}), mask_susceptibility_reduction(0.5),
               mask_virulence_reduction(0.5), mask_adoption(0.5), lockdown_type(0), lockdown_rates({{0.0}}),
               disobedience({0.0}), phase_durations({1}), lockdown_adoption(0.0), phase_thresholds({0.0}),
               threshold_buffers({0.0}), rand_type(0), rand_seed(0.0), rand_mean(1.0), rand_stddev(0.5), rand_upper(1.5),
-			  rand_lower(0.5), rand_avg_occurence_rate(5.0), precision(100) {}
+			  rand_lower(0.5), rand_avg_occurence_rate(5.0), precision(100), clock_offset(0), quiescent(false), rand_gen(nullptr), regions(nullptr), region_cell(0), adaptive(nullptr) {}
 
 
     [[maybe_unused]] config(std::vector<float> &s, std::vector<float> &v, std::vector<float> &r, std::vector<float> &m,
@@ -76,7 +90,7 @@ struct config {
             mask_use(mu), mask_susceptibility_reduction(msr), mask_virulence_reduction(mvr), mask_adoption(ma),
             lockdown_type(lt), lockdown_rates(lr), disobedience(d), phase_durations(pd), lockdown_adoption(la),
             phase_thresholds(pt), threshold_buffers(tb), rand_type(rt), rand_seed(rs), rand_mean(rm), rand_stddev(rsd), rand_upper(ru),
-			rand_lower(rl), rand_avg_occurence_rate(rao), precision(p) {}
+			rand_lower(rl), rand_avg_occurence_rate(rao), precision(p), clock_offset(0), quiescent(false), rand_gen(nullptr), regions(nullptr), region_cell(0), adaptive(nullptr) {}
 };
 
 [[maybe_unused]] void from_json(const nlohmann::json& j, config &v) {
@@ -100,11 +114,13 @@ struct config {
             j.at("disobedience").get_to(v.disobedience);
             break;
         case 2: // lockdown type: continuous reaction to infected
+        case 4: // lockdown type: continuous reaction to infected of the region
             j.at("lockdown_rates").get_to(v.lockdown_rates);
             j.at("lockdown_adoption").get_to(v.lockdown_adoption);
             j.at("disobedience").get_to(v.disobedience);
             break;
         case 3: // lockdown type: reaction to infected in phases
+        case 5: // lockdown type: reaction to infected of the region in phases
             j.at("lockdown_rates").get_to(v.lockdown_rates);
             j.at("phase_thresholds").get_to(v.phase_thresholds);
             j.at("threshold_buffers").get_to(v.threshold_buffers);
@@ -133,6 +149,8 @@ struct config {
 		default: // static (not random)
 			v.rand_type = 0;
 	}
+
+    if (j.contains("clock_offset")) j.at("clock_offset").get_to(v.clock_offset);
 	
 }
 
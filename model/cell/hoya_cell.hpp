@@ -28,8 +28,12 @@
 #ifndef CADMIUM_CELLDEVS_PANDEMIC_CELL_HPP
 #define CADMIUM_CELLDEVS_PANDEMIC_CELL_HPP
 
+#include <algorithm>
 #include <cmath>
+#include <memory>
 #include <random>
+#include <stdexcept>
+#include <string>
 #include <nlohmann/json.hpp>
 #include <cadmium/celldevs/cell/grid_cell.hpp>
 
@@ -42,8 +46,6 @@ using nlohmann::json;
 using namespace cadmium::celldevs;
 
 
-static std::default_random_engine rand_gen = std::default_random_engine();
-
 template <typename T>
 class hoya_cell : public grid_cell<T, sird, mc> {
 public:
@@ -67,9 +69,16 @@ public:
 	float mask_adoption;
 	unsigned int lockdown_type;
 	Lockdown *lockdown;
+	int clock_offset;
+	bool quiescent;
+	std::shared_ptr<region_monitor> regions;
+	std::size_t region_cell;
+	std::shared_ptr<const adaptive_resolution> adaptive;
+	unsigned int fine_population;
 	
 	unsigned int rand_type;
 	float rand_seed;
+	std::shared_ptr<std::default_random_engine> rand_gen;  // shared by all the cells of a simulation
 	mutable std::normal_distribution<float> rand_normal_dist;
 	mutable std::uniform_real_distribution<float> rand_uniform_dist;
 	mutable std::exponential_distribution<float> rand_exponential_dist;
@@ -94,8 +103,14 @@ public:
         mask_virulence_reduction = config.mask_virulence_reduction;
 		mask_adoption = config.mask_adoption;
 		precision = config.precision;
+		clock_offset = config.clock_offset;
+		quiescent = config.quiescent;
+		regions = config.regions;
+		region_cell = config.region_cell;
+		adaptive = config.adaptive;
 		age_ratio = std::vector<float>();
-		auto s = state.current_state;
+		auto s = (adaptive != nullptr) ? config.fine_state : state.current_state;
+		fine_population = s.population;
 		
 		rand_type = config.rand_type;
 		rand_seed = config.rand_seed;
@@ -115,12 +130,21 @@ public:
 				lockdown = new ReactionPhaseLockdown(config.lockdown_rates, config.phase_thresholds, config.threshold_buffers, config.disobedience);
 				break;
 
+			case 4: // lockdown type: continuous reaction to infected of the region
+				lockdown = new RegionalContinuousLockdown(config.lockdown_rates, config.lockdown_adoption, config.disobedience, regions);
+				break;
+
+			case 5: // lockdown type: reaction to infected of the region in phases
+				lockdown = new RegionalPhaseLockdown(config.lockdown_rates, config.phase_thresholds, config.threshold_buffers,
+				                                     config.disobedience, regions, regions->region(region_cell));
+				break;
+
 			default: // lockdown type: no response
 				lockdown_type = 0;
 				lockdown = new NoLockdown();
 		}
 		
-		rand_gen.seed();
+		rand_gen = (config.rand_gen != nullptr) ? config.rand_gen : std::make_shared<std::default_random_engine>();
 		switch(rand_type) {
 			case 1:
 				rand_normal_dist = std::normal_distribution<float>(config.rand_mean, config.rand_stddev);
@@ -139,16 +163,48 @@ public:
 			float ratio = std::round(precision * (s.susceptible[i] + s.infected[i] + s.recovered[i] + s.deceased[i])) / precision;
 			age_ratio.push_back(ratio);
 		}
+
+		if (regions != nullptr) {
+			regions->publish(region_cell, state.current_state, clock_offset);
+		}
 	}
 	
+	/// Replaces a parameter of the cell while the simulation is running. Lockdown and randomness parameters are fixed
+	void set_parameter(std::string const &name, json const &value) {
+		auto by_age = [&](std::vector<float> &parameter) {
+			if (!value.is_array() || value.size() != n_age_segments()
+					|| !std::all_of(value.begin(), value.end(), [](json const &v) { return v.is_number(); })) {
+				throw std::invalid_argument("parameter " + name + " must have one number per age group (" + std::to_string(n_age_segments()) + ")");
+			}
+			value.get_to(parameter);
+		};
+		auto number = [&](float &parameter) {
+			if (!value.is_number()) {
+				throw std::invalid_argument("parameter " + name + " must be a number");
+			}
+			value.get_to(parameter);
+		};
+		if (name == "susceptibility") by_age(susceptibility);
+		else if (name == "virulence") by_age(virulence);
+		else if (name == "recovery") by_age(recovery);
+		else if (name == "mortality") by_age(mortality);
+		else if (name == "infected_capacity") number(infected_capacity);
+		else if (name == "over_capacity_modifier") number(over_capacity_modifier);
+		else if (name == "mask_use") by_age(mask_use);
+		else if (name == "mask_susceptibility_reduction") number(mask_susceptibility_reduction);
+		else if (name == "mask_virulence_reduction") number(mask_virulence_reduction);
+		else if (name == "mask_adoption") number(mask_adoption);
+		else throw std::invalid_argument("parameter " + name + " cannot be changed during the simulation");
+	}
+
 	[[nodiscard]] float random() const {
 		switch(rand_type) {
 		case 1:
-			return rand_normal_dist(rand_gen);
+			return rand_normal_dist(*rand_gen);
 		case 2:
-			return rand_uniform_dist(rand_gen);
+			return rand_uniform_dist(*rand_gen);
 		case 3:
-			return rand_exponential_dist(rand_gen);
+			return rand_exponential_dist(*rand_gen);
 		default:
 			return 1.0;
 		}
@@ -161,21 +217,157 @@ public:
 	// user must define this function. It returns the next cell state and its corresponding timeout
 	[[nodiscard]] sird local_computation() const override {
 		auto res = state.current_state;
-		auto new_i = new_infections(res);
-		auto new_r = new_recoveries(res);
-		auto new_d = new_deaths(res);
+		if (quiescent && simulation_clock == 0) {  // resumed cell that would not have been evaluated at this time
+			return res;
+		}
+		lockdown->synchronize(simulation_clock + clock_offset);
+		if (adaptive == nullptr || !change_resolution(res)) {
+			auto new_i = new_infections(res);
+			auto new_r = new_recoveries(res);
+			auto new_d = new_deaths(res);
+
+			res.phase = lockdown->next_phase(simulation_clock + clock_offset, res);
+
+			// an aggregated block rounds its ratios to the same number of people as a single cell
+			float step = res.aggregated() ? precision * res.population / (float) std::max(fine_population, 1u) : precision;
+			for (int i = 0; i < n_age_segments(); i++) {
+				// an aggregated block keeps the age groups of the whole block
+				float ratio = res.aggregated() ? res.susceptible[i] + res.infected[i] + res.recovered[i] + res.deceased[i] : age_ratio[i];
+				res.recovered[i] = std::round((res.recovered[i] + new_r[i]) * step) / step;
+				res.deceased[i] = std::round((res.deceased[i] + new_d[i]) * step) / step;
+				res.infected[i] = std::round((res.infected[i] + new_i[i] - (new_r[i] + new_d[i])) * step) / step;
+				res.susceptible[i] = ratio - (res.recovered[i] + res.infected[i] + res.deceased[i]);
+			}
+			if (adaptive != nullptr && cell_id == adaptive->leader(cell_id)) {
+				res.block = next_block_mode(res);
+			}
+		}
 
-		res.phase = lockdown->next_phase(simulation_clock, res);
+		if (regions != nullptr) {
+			// cells with a regional lockdown must react to changes in their region even if nothing changes around them:
+			// as the clock is part of the state, they send it to themselves (and their neighbors) every time step
+			if (lockdown_type == 4 || lockdown_type == 5) {
+				res.region_clock = simulation_clock + clock_offset + output_delay(res);
+			}
+			// Side effect of a const method: the monitor is shared by every cell and is not part of the cell state.
+			// It is safe because Cadmium does not roll back states, and if the cell computes its state for the same
+			// time twice, only the last state published for that time counts (see region_monitor::publish)
+			regions->publish(region_cell, res, simulation_clock + clock_offset + output_delay(res));
+		}
+		return res;
+	}
+
+	/**
+	 * Hands people over between the block and the cell when the resolution of the block changes.
+	 * It returns false if the cell must follow the regular dynamics instead.
+	 */
+	bool change_resolution(sird &res) const {
+		auto const &leader = state.neighbors_state.at(adaptive->leader(cell_id));
+		switch (res.block) {
+			case block_member: // the cell stays empty until the leader splits the block
+				if (leader.block == splitting_block) {
+					res = disaggregate(leader);
+				}
+				return true;
+			case splitting_block:
+				res = disaggregate(res);
+				return true;
+			case merging_block:
+				res = aggregate(res);
+				return true;
+			default:
+				if (leader.block == merging_block && cell_id != adaptive->leader(cell_id)) {
+					res = adaptive_resolution::member_state(res);
+					return true;
+				}
+				return false;
+		}
+	}
 
+	/// Share of the cell in the aggregated state of its block
+	[[nodiscard]] sird disaggregate(sird const &block_state) const {
+		sird res = block_state;
+		res.population = fine_population;
+		res.block = fine_cell;
 		for (int i = 0; i < n_age_segments(); i++) {
-			res.recovered[i] = std::round((res.recovered[i] + new_r[i]) * precision) / precision;
-			res.deceased[i] = std::round((res.deceased[i] + new_d[i]) * precision) / precision;
-			res.infected[i] = std::round((res.infected[i] + new_i[i] - (new_r[i] + new_d[i])) * precision) / precision;
+			float block_ratio = block_state.susceptible[i] + block_state.infected[i] + block_state.recovered[i] + block_state.deceased[i];
+			float share = (block_ratio > 0) ? age_ratio[i] / block_ratio : 0;
+			res.infected[i] = block_state.infected[i] * share;
+			res.recovered[i] = block_state.recovered[i] * share;
+			res.deceased[i] = block_state.deceased[i] * share;
 			res.susceptible[i] = age_ratio[i] - (res.recovered[i] + res.infected[i] + res.deceased[i]);
 		}
 		return res;
 	}
 
+	/// Aggregated state of the block of the leader, computed from the last states of its members
+	[[nodiscard]] sird aggregate(sird const &leader_state) const {
+		std::vector<sird const *> cells = {&leader_state};
+		for (auto const &neighbor: neighbors) {
+			if (neighbor != cell_id && adaptive->same_block(neighbor, cell_id)) {
+				cells.push_back(&state.neighbors_state.at(neighbor));
+			}
+		}
+		std::vector<double> susceptible(n_age_segments()), infected(n_age_segments()), recovered(n_age_segments()), deceased(n_age_segments());
+		unsigned int population = 0;
+		for (auto const *cell: cells) {
+			population += cell->population;
+			for (int i = 0; i < n_age_segments(); i++) {
+				susceptible[i] += (double) cell->susceptible[i] * cell->population;
+				infected[i] += (double) cell->infected[i] * cell->population;
+				recovered[i] += (double) cell->recovered[i] * cell->population;
+				deceased[i] += (double) cell->deceased[i] * cell->population;
+			}
+		}
+		sird res = leader_state;
+		res.population = population;
+		res.block = block_leader;
+		for (int i = 0; i < n_age_segments(); i++) {
+			res.susceptible[i] = (population > 0) ? susceptible[i] / population : 0;
+			res.infected[i] = (population > 0) ? infected[i] / population : 0;
+			res.recovered[i] = (population > 0) ? recovered[i] / population : 0;
+			res.deceased[i] = (population > 0) ? deceased[i] / population : 0;
+		}
+		return res;
+	}
+
+	/// Leaders split their aggregated block when it becomes active, and merge it back when all its cells settle
+	[[nodiscard]] unsigned int next_block_mode(sird const &res) const {
+		float infected = res.infected_ratio();
+		if (res.block == block_leader) {
+			return (infected > adaptive->split_threshold || !smooth_surroundings(infected)) ? splitting_block : block_leader;
+		}
+		double block_infected = infected * (double) res.population;
+		double block_population = res.population;
+		for (auto const &neighbor: neighbors) {
+			if (neighbor != cell_id && adaptive->same_block(neighbor, cell_id)) {
+				auto const &member = state.neighbors_state.at(neighbor);
+				if (member.block != fine_cell || member.infected_ratio() > adaptive->merge_threshold) {
+					return fine_cell;
+				}
+				block_infected += member.infected_ratio() * (double) member.population;
+				block_population += member.population;
+			}
+		}
+		if (infected > adaptive->merge_threshold || block_population == 0) {
+			return fine_cell;
+		}
+		return smooth_surroundings(block_infected / block_population) ? merging_block : fine_cell;
+	}
+
+	/// True if the infected ratio of the cells around the block is close to the infected ratio of the block
+	[[nodiscard]] bool smooth_surroundings(double block_infected) const {
+		for (auto const &neighbor: neighbors) {
+			if (!adaptive->same_block(neighbor, cell_id)) {
+				auto const &neighbor_state = state.neighbors_state.at(neighbor);
+				if (neighbor_state.population > 0 && std::abs(neighbor_state.infected_ratio() - block_infected) > adaptive->gradient_threshold) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
 	// It returns the delay to communicate cell's new state.
 	T output_delay(sird const &cell_state) const override { return 1; }
 
@@ -188,8 +380,9 @@ public:
 		for(auto neighbor: neighbors) {
 			sird neighbor_state = state.neighbors_state.at(neighbor);
 			mc neighbor_vicinity = state.neighbors_vicinity.at(neighbor);
-			std::vector<float> mobility = find_mobility_factors(neighbor_vicinity);
-			std::vector<float> neighbor_virulence_factors = find_virulence_factors(neighbor_state);
+			std::vector<float> mobility = find_mobility_factors(last_state, neighbor_state, neighbor_vicinity);
+			// the lockdown of the neighbor depends on its own region, which the coupled model stores in the vicinity
+			std::vector<float> neighbor_virulence_factors = find_virulence_factors(neighbor_state, neighbor_vicinity.region);
 
 			for(int i = 0; i < neighbor_virulence_factors.size(); i++) {
 				virulence_factors.at(i) += neighbor_virulence_factors.at(i) * mobility.at(i);
@@ -197,7 +390,7 @@ public:
 		}
 		// ^ find how much the neighbouring cells are contributing to infection
 
-		std::vector<float> local_virulence_factors = find_virulence_factors(last_state);
+		std::vector<float> local_virulence_factors = find_virulence_factors(last_state, (regions == nullptr) ? 0 : regions->region(region_cell));
 		for(int i = 0; i < local_virulence_factors.size(); i++) {
 			virulence_factors.at(i) += local_virulence_factors.at(i);
 		}
@@ -252,10 +445,10 @@ public:
 		return new_d;
 	}
 
-	[[nodiscard]] std::vector<float> find_virulence_factors(sird const &last_state) const {
+	[[nodiscard]] std::vector<float> find_virulence_factors(sird const &last_state, unsigned int state_region) const {
 		std::vector<float> virulence_factors = {};
 		std::vector<float> mask_rates = find_mask_rates(last_state);
-		std::vector<float> lockdown_factors = lockdown->new_lockdown_factors(last_state);
+		std::vector<float> lockdown_factors = lockdown->new_lockdown_factors(last_state, state_region);
 
 		for(int i = 0; i < n_age_segments(); i++) {
 			float infected_count = last_state.infected[i] * (float)last_state.population;
@@ -288,6 +481,19 @@ public:
 		return mobility_factors;
 	}
 
+	/// Mobility factors between a neighbor and this cell, which depend on whether their blocks are aggregated
+	[[nodiscard]] std::vector<float> find_mobility_factors(sird const &last_state, sird const &neighbor_state, mc const &cell_vicinity) const {
+		std::vector<float> const *factors;
+		if (last_state.aggregated()) {
+			factors = neighbor_state.aggregated() ? &cell_vicinity.block_to_block : &cell_vicinity.block_to_fine;
+		} else if (neighbor_state.aggregated()) {
+			factors = &cell_vicinity.fine_to_block;
+		} else {
+			return find_mobility_factors(cell_vicinity);
+		}
+		return factors->empty() ? std::vector<float>(n_age_segments(), 0) : *factors;
+	}
+
 	[[nodiscard]] std::vector<float> find_mask_rates(sird const &last_state) const {
 			std::vector<float> mask_rates = std::vector<float>();
 			float total_infected = 0;
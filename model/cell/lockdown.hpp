@@ -28,10 +28,15 @@
 #ifndef PANDEMIC_HOYA_2002_LOCKDOWN_HPP
 #define PANDEMIC_HOYA_2002_LOCKDOWN_HPP
 
+#include <memory>
+#include "region_monitor.hpp"
+
 class Lockdown {
 public:
     virtual ~Lockdown() = default;
-    [[nodiscard]] virtual std::vector<float> new_lockdown_factors(sird const &last_state) const { return {}; };
+    virtual void synchronize(int simulation_clock) const {};  // called before the cell computes its next state
+    // state_region is the region of the cell whose state is last_state (only regional lockdowns use it)
+    [[nodiscard]] virtual std::vector<float> new_lockdown_factors(sird const &last_state, unsigned int state_region) const { return {}; };
     [[nodiscard]] virtual unsigned int next_phase(int simulation_clock, sird const &last_state) const { return 0; };
 };
 
@@ -39,7 +44,7 @@ class NoLockdown: public Lockdown {
 public:
     NoLockdown() = default;
 
-    [[nodiscard]] std::vector<float> new_lockdown_factors(sird const &last_state) const override {
+    [[nodiscard]] std::vector<float> new_lockdown_factors(sird const &last_state, unsigned int state_region) const override {
         return std::vector<float>(last_state.susceptible.size(), 1); // Movement is not limited (1x normal)
     }
 
@@ -63,7 +68,7 @@ public:
         }
     }
 
-    [[nodiscard]] std::vector<float> new_lockdown_factors(sird const &last_state) const override {
+    [[nodiscard]] std::vector<float> new_lockdown_factors(sird const &last_state, unsigned int state_region) const override {
         std::vector<float> lockdown_factors = {};
         for(int i = 0; i < last_state.infected.size(); i++) {
             double age_group_lockdown_factor = disobedience.at(i)
@@ -88,13 +93,18 @@ class ReactionContinuousLockdown: public Lockdown {
     const float lockdown_adoption;
     const std::vector<float> disobedience;
 
+protected:
+    [[nodiscard]] virtual float observed_infected_ratio(sird const &last_state, unsigned int state_region) const {
+        return last_state.infected_ratio();
+    }
+
 public:
     ReactionContinuousLockdown(std::vector<std::vector<float>> &lr, float &la, std::vector<float> &d):
         lockdown_rates(lr), lockdown_adoption(la), disobedience(d) {}
 
-    [[nodiscard]] std::vector<float> new_lockdown_factors(sird const &last_state) const override {
+    [[nodiscard]] std::vector<float> new_lockdown_factors(sird const &last_state, unsigned int state_region) const override {
         std::vector<float> lockdown_factors = {};
-        float total_infected = last_state.infected_ratio();
+        float total_infected = observed_infected_ratio(last_state, state_region);
         double lockdown_strength;
         double age_group_lockdown_factor;
 
@@ -119,19 +129,24 @@ class ReactionPhaseLockdown: public Lockdown {
 
     [[nodiscard]] bool shouldGoToNextPhase(sird const &last_state) const {
         return (last_state.phase + 1 < phase_thresholds.size()
-            && last_state.infected_ratio() >= phase_thresholds[last_state.phase + 1]);
+            && observed_infected_ratio(last_state) >= phase_thresholds[last_state.phase + 1]);
     }
 
     [[nodiscard]] bool shouldGoToPreviousPhase(sird const &last_state) const {
         return (last_state.phase > 0
-            && (last_state.infected_ratio() + threshold_buffers[last_state.phase]) < phase_thresholds[last_state.phase]);
+            && (observed_infected_ratio(last_state) + threshold_buffers[last_state.phase]) < phase_thresholds[last_state.phase]);
+    }
+
+protected:
+    [[nodiscard]] virtual float observed_infected_ratio(sird const &last_state) const {
+        return last_state.infected_ratio();
     }
 
 public:
     ReactionPhaseLockdown(std::vector<std::vector<float>> &lr, std::vector<float> &pt, std::vector<float> &tb,
                           std::vector<float> &d): lockdown_rates(lr), phase_thresholds(pt), threshold_buffers(tb), disobedience(d) {}
 
-    [[nodiscard]] std::vector<float> new_lockdown_factors(sird const &last_state) const override {
+    [[nodiscard]] std::vector<float> new_lockdown_factors(sird const &last_state, unsigned int state_region) const override {
         std::vector<float> lockdown_factors = {};
         for(int i = 0; i < last_state.infected.size(); i++) {
             double age_group_lockdown_factor = disobedience.at(i)
@@ -152,4 +167,43 @@ public:
     }
 };
 
+// Regional lockdowns react to the infected ratio of the region of the cell instead of the ratio of the cell itself
+// The strength of a continuous lockdown depends on the region of the cell that holds the state (e.g., a neighbor)
+class RegionalContinuousLockdown: public ReactionContinuousLockdown {
+    const std::shared_ptr<region_monitor> regions;
+
+protected:
+    [[nodiscard]] float observed_infected_ratio(sird const &last_state, unsigned int state_region) const override {
+        return regions->infected_ratio(state_region);
+    }
+
+public:
+    RegionalContinuousLockdown(std::vector<std::vector<float>> &lr, float &la, std::vector<float> &d,
+                               std::shared_ptr<region_monitor> const &rm):
+        ReactionContinuousLockdown(lr, la, d), regions(rm) {}
+
+    void synchronize(int simulation_clock) const override {
+        regions->reduce(simulation_clock);
+    }
+};
+
+class RegionalPhaseLockdown: public ReactionPhaseLockdown {
+    const std::shared_ptr<region_monitor> regions;
+    const unsigned int region;
+
+protected:
+    [[nodiscard]] float observed_infected_ratio(sird const &last_state) const override {
+        return regions->infected_ratio(region);
+    }
+
+public:
+    RegionalPhaseLockdown(std::vector<std::vector<float>> &lr, std::vector<float> &pt, std::vector<float> &tb,
+                          std::vector<float> &d, std::shared_ptr<region_monitor> const &rm, unsigned int r):
+        ReactionPhaseLockdown(lr, pt, tb, d), regions(rm), region(r) {}
+
+    void synchronize(int simulation_clock) const override {
+        regions->reduce(simulation_clock);
+    }
+};
+
 #endif //PANDEMIC_HOYA_2002_LOCKDOWN_HPP
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PANDEMIC_HOYA_2002_REGION_MONITOR_HPP
+#define PANDEMIC_HOYA_2002_REGION_MONITOR_HPP
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "state.hpp"
+
+/**
+ * Infected ratio of every region of the lattice, shared by all the cells of a simulation.
+ * Cells publish their states as they compute them, together with the time from which they hold.
+ * The monitor keeps the number of infected people and the population of every region, and only updates them with
+ * the changes published for the time steps that have already been reached. Thus, the cost of a time step depends on
+ * the number of cells that computed a new state, not on the size of the lattice.
+ * Unlike couplings (e.g., long-range links), the monitor does not wake cells up when their region changes:
+ * cells with a regional lockdown keep themselves active instead (see hoya_cell::local_computation).
+ */
+class region_monitor {
+    /// Change in the infected people and population of a region from a given time on
+    struct update {
+        int time;
+        unsigned int region;
+        double infected;
+        double population;
+    };
+
+    std::vector<unsigned int> region_of;
+    std::vector<double> published_infected;  // last state published by every cell
+    std::vector<double> published_population;
+    std::vector<update> pending;  // changes published for time steps that have not been reached yet
+    std::vector<double> infected;
+    std::vector<double> population;
+    std::vector<float> ratios;
+    int reduced_time;
+
+public:
+    /// @param regions region of every cell of the lattice (row-major order).
+    explicit region_monitor(std::vector<unsigned int> regions): region_of(std::move(regions)),
+            published_infected(region_of.size(), 0), published_population(region_of.size(), 0),
+            reduced_time(std::numeric_limits<int>::min()) {
+        unsigned int n_regions = region_of.empty()? 1 : *std::max_element(region_of.begin(), region_of.end()) + 1;
+        infected = std::vector<double>(n_regions, 0);
+        population = std::vector<double>(n_regions, 0);
+        ratios = std::vector<float>(n_regions, 0);
+    }
+
+    [[nodiscard]] unsigned int region(std::size_t cell) const {
+        return region_of.at(cell);
+    }
+
+    /// Records the state that a cell has from a given time on
+    void publish(std::size_t cell, sird const &state, int time) {
+        auto cell_population = (double) state.population;
+        double cell_infected = cell_population * state.infected_ratio();
+        update u = {time, region_of.at(cell), cell_infected - published_infected[cell], cell_population - published_population[cell]};
+        published_infected[cell] = cell_infected;
+        published_population[cell] = cell_population;
+        if (u.infected != 0 || u.population != 0) {
+            pending.push_back(u);
+        }
+    }
+
+    /// Computes the infected ratio of every region at a given time. It only does the work once per time step
+    void reduce(int time) {
+        if (time == reduced_time) {
+            return;
+        }
+        reduced_time = time;
+        auto reached = std::stable_partition(pending.begin(), pending.end(), [time](update const &u) { return u.time > time; });
+        for (auto it = reached; it != pending.end(); ++it) {
+            infected[it->region] += it->infected;
+            population[it->region] += it->population;
+        }
+        pending.erase(reached, pending.end());
+        for (std::size_t r = 0; r < ratios.size(); r++) {
+            ratios[r] = (population[r] > 0)? (float) (infected[r] / population[r]) : 0;
+        }
+    }
+
+    /// Infected ratio of a region at the time of the last reduction
+    [[nodiscard]] float infected_ratio(unsigned int region) const {
+        return ratios.at(region);
+    }
+};
+
+#endif //PANDEMIC_HOYA_2002_REGION_MONITOR_HPP
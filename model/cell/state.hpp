@@ -30,17 +30,28 @@
 
 #include <nlohmann/json.hpp>
 
+/// Resolution of a cell when the lattice is simulated with adaptive resolution (see adaptive_resolution.hpp)
+enum block_mode : unsigned int {
+    fine_cell = 0,        // the cell is simulated on its own
+    block_leader = 1,     // the cell holds the aggregated state of its whole block
+    block_member = 2,     // the people of the cell are aggregated in the leader of its block
+    splitting_block = 3,  // the leader hands the aggregated state back to its members
+    merging_block = 4     // the members hand their states over to the leader
+};
+
 struct sird {
     unsigned int population;
     unsigned int phase;
+    unsigned int block;
+    int region_clock;  // time from which a cell with a regional lockdown holds the state (see hoya_cell.hpp)
     std::vector<float> susceptible;
     std::vector<float> infected;
     std::vector<float> recovered;
     std::vector<float> deceased;
 
-    sird() : population(0), susceptible({1}), infected({0}), recovered({0}), deceased({0}), phase(0) {}
+    sird() : population(0), susceptible({1}), infected({0}), recovered({0}), deceased({0}), phase(0), block(fine_cell), region_clock(0) {}
     sird(unsigned int pop, std::vector<float> &s, std::vector<float> &i, std::vector<float> &r, std::vector<float> &d) :
-            population(pop), susceptible(s), infected(i), recovered(r), deceased(d), phase(0) {}
+            population(pop), susceptible(s), infected(i), recovered(r), deceased(d), phase(0), block(fine_cell), region_clock(0) {}
 
     template <typename T>
     static T sum_vector(std::vector<T> const &v) {
@@ -61,11 +72,16 @@ struct sird {
     [[maybe_unused]] [[nodiscard]] float recovered_ratio() const {
         return sum_vector<float>(recovered);
     }
+
+    /// True if the state stands for the whole block of the cell
+    [[nodiscard]] bool aggregated() const {
+        return block == block_leader || block == splitting_block;
+    }
 };
 // Required for comparing states and detect any change
 inline bool operator != (const sird &x, const sird &y) {
-    return x.population != y.population || x.susceptible != y.susceptible || x.infected != y.infected ||
-           x.recovered != y.recovered || x.deceased != y.deceased;
+    return x.population != y.population || x.phase != y.phase || x.susceptible != y.susceptible || x.infected != y.infected ||
+           x.recovered != y.recovered || x.deceased != y.deceased || x.block != y.block || x.region_clock != y.region_clock;
 }
 // Required if you want to use transport delay (priority queue has to sort messages somehow)
 inline bool operator < (const sird& lhs, const sird& rhs){ return true; }
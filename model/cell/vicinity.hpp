@@ -33,8 +33,13 @@
 struct mc {
     std::vector<float> connection;
     std::vector<float> movement;
-    mc() : connection({ 0 }), movement({ 0 }) {}  // a default constructor is required
-    mc(std::vector<float> &c, std::vector<float> &m) : connection(c), movement(m) {}
+    // Mobility factors used instead of connection times movement when blocks are aggregated (empty means no mobility)
+    std::vector<float> fine_to_block;   // the neighbor holds the aggregated state of its block
+    std::vector<float> block_to_fine;   // this cell holds the aggregated state of its block
+    std::vector<float> block_to_block;  // both cells hold the aggregated state of their blocks
+    unsigned int region;  // region of the neighbor, set by the coupled model for regional lockdowns
+    mc() : connection({ 0 }), movement({ 0 }), region(0) {}  // a default constructor is required
+    mc(std::vector<float> &c, std::vector<float> &m) : connection(c), movement(m), region(0) {}
 };
 
 // Required for creating movement-connection objects from JSON file
@@ -0,0 +1,247 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PANDEMIC_HOYA_2002_FRAME_RENDERER_HPP
+#define PANDEMIC_HOYA_2002_FRAME_RENDERER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "cell/state.hpp"
+
+struct frame_config {
+    std::string field;
+    unsigned int every;
+    unsigned int scale;
+    std::string directory;
+    std::vector<float> range;
+    std::vector<std::string> colors;
+    unsigned int queue_size;
+
+    frame_config(): field("infected"), every(1), scale(4), directory("./simulation_results/frames"),
+                    range({0.0, 1.0}), colors({"#ffffff", "#e74c3c"}), queue_size(16) {}
+};
+
+// Default color maps go from white to the colors used by automation/notebook.py
+[[maybe_unused]] void from_json(const nlohmann::json& j, frame_config &v) {
+    j.at("field").get_to(v.field);
+    if (v.field != "susceptible" && v.field != "infected" && v.field != "recovered" && v.field != "deceased" && v.field != "phase") {
+        throw std::invalid_argument("unknown field of the visualization: " + v.field +
+                                    " (it must be susceptible, infected, recovered, deceased or phase)");
+    }
+    if (v.field == "susceptible") {
+        v.colors = {"#ffffff", "#3498db"};
+    } else if (v.field == "recovered") {
+        v.colors = {"#ffffff", "#2ecc71"};
+    } else if (v.field == "deceased") {
+        v.colors = {"#ffffff", "#8ba2ad"};
+    } else if (v.field == "phase") {
+        v.range = {0.0, 2.0};
+    }
+    if (j.contains("every")) j.at("every").get_to(v.every);
+    if (j.contains("scale")) j.at("scale").get_to(v.scale);
+    if (j.contains("directory")) j.at("directory").get_to(v.directory);
+    if (j.contains("range")) j.at("range").get_to(v.range);
+    if (j.contains("colors")) j.at("colors").get_to(v.colors);
+    if (j.contains("queue_size")) j.at("queue_size").get_to(v.queue_size);
+}
+
+/**
+ * Renders one field of the lattice to PPM images.
+ * The simulation thread only samples the field of every cell; color mapping and encoding happen in a background thread.
+ * At most queue_size frames wait to be encoded. If the encoder falls further behind, the simulation waits for it.
+ */
+class frame_renderer {
+    using rgb = std::array<unsigned char, 3>;
+
+    struct frame {
+        int number;  // frames are numbered consecutively, so that video encoders find them all
+        int time;
+        std::vector<float> values;
+    };
+
+    frame_config config;
+    std::vector<int> shape;
+    std::vector<rgb> color_map;
+    int n_frames;
+    bool write_failed;  // only the first frame that cannot be written is reported (only used by the encoder thread)
+
+    std::deque<frame> pending;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable frame_ready;
+    std::condition_variable frame_done;
+    std::thread encoder;
+
+    [[nodiscard]] static rgb parse_color(std::string const &hex) {
+        unsigned int r = 0, g = 0, b = 0;
+        std::sscanf(hex.c_str(), "#%02x%02x%02x", &r, &g, &b);
+        return {(unsigned char) r, (unsigned char) g, (unsigned char) b};
+    }
+
+    /// Linear interpolation between evenly spaced color stops
+    [[nodiscard]] rgb color(float value) const {
+        float lower = config.range.at(0), upper = config.range.at(1);
+        float ratio = (upper > lower)? (value - lower) / (upper - lower) : 0;
+        ratio = std::clamp(ratio, 0.0f, 1.0f) * (float) (color_map.size() - 1);
+        auto stop = std::min((std::size_t) ratio, color_map.size() - 1);
+        auto next = std::min(stop + 1, color_map.size() - 1);
+        float weight = ratio - (float) stop;
+        rgb res{};
+        for (int c = 0; c < 3; c++) {
+            res[c] = (unsigned char) ((1 - weight) * color_map[stop][c] + weight * color_map[next][c] + 0.5f);
+        }
+        return res;
+    }
+
+    void write_frame(frame const &f) {
+        unsigned int width = shape.at(1) * config.scale;
+        unsigned int height = shape.at(0) * config.scale;
+        std::vector<unsigned char> pixels(3 * (std::size_t) width * height);
+        for (int x = 0; x < shape[0]; x++) {
+            for (int y = 0; y < shape[1]; y++) {
+                rgb c = color(f.values[x * shape[1] + y]);
+                for (unsigned int dx = 0; dx < config.scale; dx++) {
+                    unsigned char *row = pixels.data() + 3 * ((std::size_t) (x * config.scale + dx) * width + y * config.scale);
+                    for (unsigned int dy = 0; dy < config.scale; dy++) {
+                        std::copy(c.begin(), c.end(), row + 3 * dy);
+                    }
+                }
+            }
+        }
+        char file_name[32];
+        std::snprintf(file_name, sizeof(file_name), "frame_%06d.ppm", f.number);
+        std::FILE *file = std::fopen((std::filesystem::path(config.directory) / file_name).c_str(), "wb");
+        if (file == nullptr) {
+            if (!write_failed) {
+                std::cerr << "Frames cannot be written to " << config.directory << ": " << std::strerror(errno) << std::endl;
+                write_failed = true;
+            }
+            return;
+        }
+        std::fprintf(file, "P6\n# time %d\n%u %u\n255\n", f.time, width, height);
+        std::fwrite(pixels.data(), 1, pixels.size(), file);
+        std::fclose(file);
+    }
+
+    void encode_loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            frame_ready.wait(lock, [this] { return !pending.empty() || stopping; });
+            if (pending.empty()) {
+                return;
+            }
+            frame next = std::move(pending.front());
+            lock.unlock();
+            write_frame(next);
+            lock.lock();
+            pending.pop_front();
+            frame_done.notify_all();
+        }
+    }
+
+public:
+    frame_renderer(frame_config c, std::vector<int> lattice_shape): config(std::move(c)), shape(std::move(lattice_shape)),
+                                                                    n_frames(0), write_failed(false), stopping(false) {
+        if (shape.size() != 2) {
+            throw std::invalid_argument("frames can only be rendered from 2D lattices (the lattice has " +
+                                        std::to_string(shape.size()) + " dimensions)");
+        }
+        for (auto const &hex: config.colors) {
+            color_map.push_back(parse_color(hex));
+        }
+        if (color_map.empty()) {
+            color_map.push_back({0, 0, 0});
+        }
+        config.every = std::max(config.every, 1u);
+        config.scale = std::max(config.scale, 1u);
+        config.queue_size = std::max(config.queue_size, 1u);
+        std::filesystem::create_directories(config.directory);
+        encoder = std::thread(&frame_renderer::encode_loop, this);
+    }
+
+    frame_renderer(frame_renderer const &) = delete;
+    frame_renderer &operator = (frame_renderer const &) = delete;
+
+    ~frame_renderer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        frame_ready.notify_one();
+        encoder.join();
+    }
+
+    [[nodiscard]] bool renders(int time) const {
+        return time % config.every == 0;
+    }
+
+    /// Value of the rendered field for a given cell state
+    [[nodiscard]] float sample(sird const &s) const {
+        if (config.field == "susceptible") return s.susceptible_ratio();
+        if (config.field == "recovered") return s.recovered_ratio();
+        if (config.field == "deceased") return sird::sum_vector<float>(s.deceased);
+        if (config.field == "phase") return (float) s.phase;
+        return s.infected_ratio();
+    }
+
+    /**
+     * Samples the lattice and queues the frame for encoding.
+     * @param time simulation time of the frame. It is written in a comment of the image file.
+     * @param lattice cells in row-major order.
+     */
+    template <typename CELLS>
+    void capture(int time, CELLS const &lattice) {
+        if (!renders(time)) {
+            return;
+        }
+        frame f{n_frames++, time, std::vector<float>(lattice.size(), 0)};
+        for (std::size_t i = 0; i < lattice.size(); i++) {
+            if (lattice[i] != nullptr) {
+                f.values[i] = sample(lattice[i]->state.current_state);
+            }
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        frame_done.wait(lock, [this] { return pending.size() < config.queue_size; });
+        pending.push_back(std::move(f));
+        frame_ready.notify_one();
+    }
+};
+
+#endif //PANDEMIC_HOYA_2002_FRAME_RENDERER_HPP
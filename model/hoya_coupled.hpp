@@ -28,24 +28,526 @@
 #ifndef CADMIUM_CELLDEVS_HOYA_COUPLED_HPP
 #define CADMIUM_CELLDEVS_HOYA_COUPLED_HPP
 
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
 #include <cadmium/celldevs/coupled/grid_coupled.hpp>
 #include "cell/hoya_cell.hpp"
 
+/// Long-range connection through which the infected people of one cell reach a distant cell (e.g., airports)
+struct mobility_link {
+    cell_position from;
+    cell_position to;
+    std::vector<float> weight;
+};
+
+[[maybe_unused]] void from_json(const nlohmann::json& j, mobility_link &l) {
+    j.at("from").get_to(l.from);
+    j.at("to").get_to(l.to);
+    j.at("weight").get_to(l.weight);
+}
+
 template <typename T>
 class hoya_coupled : public cadmium::celldevs::grid_coupled<T, sird, mc> {
+    /// Cell read from the scenario, whose model is only added once every cell of the lattice has been read
+    struct pending_cell {
+        cell_map<sird, mc> map;
+        std::string delay_id;
+        config conf;
+    };
+
+    std::vector<std::shared_ptr<hoya_cell<T>>> cells;
+    std::unordered_map<std::size_t, std::vector<mobility_link>> incoming_links;  // links by index of the destination cell
+    std::shared_ptr<std::default_random_engine> rand_gen;
+    std::shared_ptr<region_monitor> regions;
+    std::shared_ptr<const adaptive_resolution> adaptive;
+    std::vector<pending_cell> pending;
+    // Most cells share their configuration: the last one is only parsed (and patched) again if it changes
+    nlohmann::json last_config;
+    config last_parsed_config;
+    bool config_cached = false;
+
+    /// Parsed configuration of a cell, with the configuration patch applied
+    config &parse_config(nlohmann::json const &cell_config) {
+        if (!config_cached || cell_config != last_config) {
+            last_config = cell_config;
+            nlohmann::json patched = cell_config;
+            if (config_patch.is_object()) {
+                patched.merge_patch(config_patch);
+            }
+            last_parsed_config = patched.get<config>();
+            config_cached = true;
+        }
+        return last_parsed_config;
+    }
+
+    /**
+     * Adds the sources of the long-range links of a cell to its neighborhood.
+     * Each link is one more neighbor whose vicinity factor is the weight of the link, so it stacks on top of the
+     * neighborhood of the scenario, and its cost only depends on the number of links.
+     * Links are regular couplings because people travel between two given cells: the destination must be evaluated
+     * again when the source changes. Regional lockdowns instead read an aggregate of many cells, which would need a
+     * coupling per pair of cells of the region, so they use a region_monitor (see region_monitor.hpp).
+     */
+    void add_links(cell_map<sird, mc> &map) const {
+        auto it = incoming_links.find(cell_index(map.location));
+        if (it == incoming_links.end()) {
+            return;
+        }
+        for (auto const &link: it->second) {
+            std::vector<float> connection = link.weight;
+            std::vector<float> movement(connection.size(), 1);
+            auto neighbor = map.neighborhood.find(link.from);
+            if (neighbor != map.neighborhood.end()) {  // the source is already a neighbor: both factors are added
+                for (std::size_t i = 0; i < connection.size(); i++) {
+                    connection[i] += neighbor->second.connection.at(i) * neighbor->second.movement.at(i);
+                }
+            }
+            map.neighborhood[link.from] = mc(connection, movement);
+        }
+    }
+
+    /// Vicinity of a neighbor of a cell. If they are not neighbors yet, the neighbor is added without any mobility
+    static mc &vicinity(cell_map<sird, mc> &map, cell_position const &neighbor) {
+        auto it = map.neighborhood.find(neighbor);
+        if (it == map.neighborhood.end()) {
+            std::vector<float> zeros(map.state.susceptible.size(), 0);
+            it = map.neighborhood.emplace(neighbor, mc(zeros, zeros)).first;
+        }
+        return it->second;
+    }
+
+    /// Stores the region of every neighbor in its vicinity, as the lockdown of a neighbor depends on its region
+    void add_neighbor_regions(cell_map<sird, mc> &map) const {
+        if (regions == nullptr) {
+            return;
+        }
+        for (auto &neighbor: map.neighborhood) {
+            neighbor.second.region = regions->region(cell_index(neighbor.first));
+        }
+    }
+
+    static void add_factor(std::vector<float> &factors, std::size_t n_ages, std::size_t age, float value) {
+        factors.resize(n_ages, 0);
+        factors[age] += value;
+    }
+
+    /**
+     * Adds the cells of the lattice divided in blocks (see adaptive_resolution.hpp).
+     * Every pair of neighbors also couples their blocks: the mobility factors used while blocks are aggregated are
+     * the sums of the mobility factors between their cells, weighted by the population of the cells of the source.
+     * Leaders listen to all their members and members to their leader, so people can be handed over.
+     * Blocks start aggregated unless they already have an outbreak, no population, or come from a snapshot.
+     */
+    void add_blocks() {
+        std::vector<pending_cell *> by_index(n_cells());
+        for (auto &cell: pending) {
+            by_index[cell_index(cell.map.location)] = &cell;
+        }
+        std::vector<double> block_population(n_cells(), 0);  // by index of the leader of the block
+        for (auto &cell: pending) {
+            block_population[cell_index(adaptive->leader(cell.map.location))] += cell.conf.fine_state.population;
+        }
+
+        for (auto &cell: pending) {
+            adaptive->check_rounding(cell.conf.recovery, cell.conf.mortality, cell.conf.precision);
+            auto const &location = cell.map.location;
+            auto const leader = adaptive->leader(location);
+            auto &leader_map = by_index[cell_index(leader)]->map;
+            std::size_t n_ages = cell.map.state.susceptible.size();
+            auto const neighborhood = cell.map.neighborhood;  // entries added below must not be visited
+            for (auto const &[neighbor, factors]: neighborhood) {
+                auto const source_leader = adaptive->leader(neighbor);
+                double source_population = block_population[cell_index(source_leader)];
+                double population_share = (source_population > 0) ?
+                        by_index[cell_index(neighbor)]->conf.fine_state.population / source_population : 0;
+                for (std::size_t age = 0; age < n_ages; age++) {
+                    float mobility = factors.connection.at(age) * factors.movement.at(age);
+                    if (mobility == 0) {
+                        continue;
+                    }
+                    if (!adaptive->same_block(location, neighbor)) {
+                        add_factor(vicinity(cell.map, source_leader).fine_to_block, n_ages, age, mobility * population_share);
+                        add_factor(vicinity(leader_map, neighbor).block_to_fine, n_ages, age, mobility);
+                    }
+                    add_factor(vicinity(leader_map, source_leader).block_to_block, n_ages, age, mobility * population_share);
+                }
+            }
+            vicinity(cell.map, leader);
+            vicinity(leader_map, location);
+        }
+
+        std::vector<bool> fine(n_cells(), false);  // by index of the leader of the block
+        for (auto &cell: pending) {
+            auto const &s = cell.map.state;
+            auto block = cell_index(adaptive->leader(cell.map.location));
+            if (s.block != fine_cell || s.infected_ratio() > adaptive->split_threshold || block_population[block] == 0) {
+                fine[block] = true;
+            }
+        }
+        std::vector<sird> blocks(n_cells());  // aggregated states, by index of the leader of the block
+        for (auto &cell: pending) {
+            auto const &s = cell.map.state;
+            auto block = cell_index(adaptive->leader(cell.map.location));
+            if (fine[block]) {
+                continue;
+            }
+            if (blocks[block].block != block_leader) {
+                blocks[block] = adaptive_resolution::member_state(s);
+                blocks[block].block = block_leader;
+            }
+            blocks[block].population += s.population;
+            for (std::size_t i = 0; i < s.susceptible.size(); i++) {
+                blocks[block].susceptible[i] += s.susceptible[i] * s.population / block_population[block];
+                blocks[block].infected[i] += s.infected[i] * s.population / block_population[block];
+                blocks[block].recovered[i] += s.recovered[i] * s.population / block_population[block];
+                blocks[block].deceased[i] += s.deceased[i] * s.population / block_population[block];
+            }
+        }
+        for (auto &cell: pending) {
+            auto block = cell_index(adaptive->leader(cell.map.location));
+            if (!fine[block]) {
+                cell.map.state = (block == cell_index(cell.map.location)) ? blocks[block] : adaptive_resolution::member_state(cell.map.state);
+            }
+            add_neighbor_regions(cell.map);
+            cell.conf.quiescent = resumes_quiescent(cell.map);
+            this->template add_cell<hoya_cell>(cell.map, cell.delay_id, cell.conf);
+        }
+        pending.clear();
+    }
+
+    /// True if a cell resumed from a snapshot would not have been evaluated, as none of its neighbors just changed
+    [[nodiscard]] bool resumes_quiescent(cell_map<sird, mc> const &map) const {
+        if (initial_changes == nullptr) {
+            return false;
+        }
+        for (auto const &neighbor: map.neighborhood) {
+            if (initial_changes->at(cell_index(neighbor.first))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// True if any cell of the scenario reacts to the infected ratio of its region (lockdown types 4 and 5)
+    [[nodiscard]] bool regional_lockdown(nlohmann::json const &j) const {
+        auto regional = [](nlohmann::json const &cell_config) {
+            if (!cell_config.is_object() || !cell_config.contains("lockdown_type")) {
+                return false;
+            }
+            auto type = cell_config.at("lockdown_type").get<unsigned int>();
+            return type == 4 || type == 5;
+        };
+        if (config_patch.is_object() && config_patch.contains("lockdown_type")) {
+            return regional(config_patch);
+        }
+        auto const &scenario = j.at("scenario");
+        if (scenario.contains("default_config") && scenario.at("default_config").contains("hoya_age")
+                && regional(scenario.at("default_config").at("hoya_age"))) {
+            return true;
+        }
+        if (j.contains("cells")) {
+            for (auto const &cell: j.at("cells")) {
+                if (cell.contains("config") && regional(cell.at("config"))) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /// Region of every cell in row-major order. Without a "regions" raster, the whole lattice is a single region
+    [[nodiscard]] std::vector<unsigned int> read_regions(nlohmann::json const &j) const {
+        if (!j.contains("regions")) {
+            return std::vector<unsigned int>(n_cells(), 0);
+        }
+        std::vector<unsigned int> res;
+        std::function<void(nlohmann::json const &)> flatten = [&](nlohmann::json const &raster) {
+            if (!raster.is_array()) {
+                res.push_back(raster.get<unsigned int>());
+                return;
+            }
+            for (auto const &row: raster) {
+                flatten(row);
+            }
+        };
+        flatten(j.at("regions"));
+        if (res.size() != n_cells()) {
+            throw std::invalid_argument("the regions raster does not match the shape of the lattice");
+        }
+        return res;
+    }
+
 public:
+    std::vector<int> shape;
+    nlohmann::json config_patch;  // JSON merge patch applied to the configuration of every cell (e.g., calibrated parameters)
+    std::shared_ptr<const std::vector<sird>> initial_states;  // if set, replaces the initial state of every cell (row-major order)
+    std::shared_ptr<const std::vector<bool>> initial_changes;  // if set, cells whose neighbors did not change are not evaluated at first
 
     explicit hoya_coupled(std::string const &id) : grid_coupled<T, sird, mc>(id){}
 
     template <typename X>
     using cell_unordered = std::unordered_map<std::string,X>;
 
+    /// Reads a scenario file and adds its lattice (see the overload below). The file is only parsed once
+    void add_lattice_json(std::string const &file_path) {
+        std::ifstream i(file_path);
+        nlohmann::json j;
+        i >> j;
+        add_lattice_json(j);
+    }
+
+    /**
+     * Adds the lattice of a scenario that has already been parsed.
+     * The cell maps are generated from the shape and the neighborhood of the scenario: the relative positions of the
+     * neighborhood are computed once, and only the cells listed in "cells" parse their own state or configuration.
+     */
+    void add_lattice_json(nlohmann::json const &j) {
+        j.at("scenario").at("shape").get_to(shape);
+        incoming_links.clear();
+        if (j.contains("links")) {
+            auto const &default_state = j.at("scenario").at("default_state");
+            std::size_t n_ages = default_state.contains("susceptible") ? default_state.at("susceptible").size() : 1;
+            for (auto const &link: j.at("links").get<std::vector<mobility_link>>()) {
+                if (!in_lattice(link.from) || !in_lattice(link.to)) {
+                    throw std::out_of_range("long-range link with a cell out of the lattice");
+                }
+                if (link.weight.size() != n_ages) {
+                    throw std::invalid_argument("long-range link from " + position_name(link.from) + " to " +
+                            position_name(link.to) + " must have one weight per age group (" + std::to_string(n_ages) + ")");
+                }
+                incoming_links[cell_index(link.to)].push_back(link);
+            }
+        }
+        regions = regional_lockdown(j) ? std::make_shared<region_monitor>(read_regions(j)) : nullptr;
+#ifdef HOYA_ADAPTIVE_RESOLUTION
+        adaptive = j.contains("adaptive") ? std::make_shared<const adaptive_resolution>(j.at("adaptive").get<adaptive_resolution>()) : nullptr;
+#else
+        if (j.contains("adaptive")) {  // experimental: it has not been shown to speed up simulations on Cadmium yet
+            throw std::invalid_argument("adaptive resolution is experimental: build with -DHOYA_ADAPTIVE_RESOLUTION=ON to use it");
+        }
+#endif
+        config_cached = false;  // the configuration patch may have changed
+        // one engine per simulation, so simulations are reproducible and independent of the threads that run them
+        auto const &scenario = j.at("scenario");
+        float seed = (scenario.contains("default_config") && scenario.at("default_config").contains("hoya_age")) ?
+                parse_config(scenario.at("default_config").at("hoya_age")).rand_seed : 0;
+        rand_gen = std::make_shared<std::default_random_engine>((std::default_random_engine::result_type) seed);
+        this->_models.reserve(this->_models.size() + n_cells());
+        add_cells(j);  // Cadmium still builds the ports of every cell in add_cell, and the couplings in couple_cells
+        if (adaptive != nullptr) {
+            add_blocks();
+        }
+    }
+
+    [[nodiscard]] bool in_lattice(cell_position const &position) const {
+        if (position.size() != shape.size()) {
+            return false;
+        }
+        for (int dim = 0; dim < (int) shape.size(); dim++) {
+            if (position[dim] < 0 || position[dim] >= shape[dim]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Position in the format of the scenario file (e.g., "[2,3]"), for error messages
+    [[nodiscard]] static std::string position_name(cell_position const &position) {
+        return nlohmann::json(position).dump();
+    }
+
+    [[nodiscard]] std::size_t n_cells() const {
+        std::size_t res = 1;
+        for (int dim: shape) {
+            res *= dim;
+        }
+        return res;
+    }
+
+    /// Position of a cell in row-major order
+    [[nodiscard]] std::size_t cell_index(cell_position const &position) const {
+        std::size_t index = 0;
+        for (int dim = 0; dim < (int) shape.size(); dim++) {
+            index = index * shape[dim] + position[dim];
+        }
+        return index;
+    }
+
+    /// Random engine shared by the cells of the lattice
+    [[nodiscard]] std::default_random_engine &random_engine() {
+        return *rand_gen;
+    }
+
+    /// Position of a cell from its index in row-major order
+    [[nodiscard]] cell_position cell_location(std::size_t index) const {
+        cell_position res(shape.size());
+        for (int dim = (int) shape.size() - 1; dim >= 0; dim--) {
+            res[dim] = (int) (index % shape[dim]);
+            index /= shape[dim];
+        }
+        return res;
+    }
+
+    /// Neighbor of a neighborhood entry. A relative entry is moved to the location of the cell
+    struct neighbor_rule {
+        cell_position position;
+        bool relative;
+        mc vicinity;
+    };
+
+    /// Neighbor rules of the "neighborhood" array of a scenario (or of a cell), computed once for all the cells
+    [[nodiscard]] std::vector<neighbor_rule> read_neighborhood(nlohmann::json const &neighborhoods) const {
+        std::vector<neighbor_rule> res;
+        for (auto const &neighborhood: neighborhoods) {
+            auto type = neighborhood.at("type").get<std::string>();
+            auto vicinity = neighborhood.at("vicinity").get<mc>();
+            if (type == "von_neumann" || type == "moore") {
+                int range = neighborhood.value("range", 1);
+                cell_position offset(shape.size(), -range);
+                while (true) {
+                    int distance = 0;
+                    for (int i: offset) {
+                        distance = (type == "moore") ? std::max(distance, std::abs(i)) : distance + std::abs(i);
+                    }
+                    if (distance <= range) {
+                        res.push_back({offset, true, vicinity});
+                    }
+                    std::size_t dim = 0;  // next offset of the hypercube
+                    while (dim < offset.size() && offset[dim] == range) {
+                        offset[dim++] = -range;
+                    }
+                    if (dim == offset.size()) {
+                        break;
+                    }
+                    offset[dim]++;
+                }
+            } else if (type == "relative" || type == "absolute") {
+                for (auto const &neighbor: neighborhood.at("neighbors")) {
+                    res.push_back({neighbor.get<cell_position>(), type == "relative", vicinity});
+                }
+            } else {
+                throw std::invalid_argument("unknown neighborhood type: " + type);
+            }
+        }
+        return res;
+    }
+
+    /// Applies neighbor rules to a cell. Neighbors out of the lattice are wrapped around it or dropped
+    void set_neighborhood(cell_map<sird, mc> &map, std::vector<neighbor_rule> const &rules, bool wrapped) const {
+        map.neighborhood.clear();
+        for (auto const &rule: rules) {
+            cell_position neighbor = rule.position;
+            if (rule.relative) {
+                for (std::size_t dim = 0; dim < shape.size(); dim++) {
+                    neighbor[dim] += map.location[dim];
+                    if (wrapped) {
+                        neighbor[dim] = ((neighbor[dim] % shape[dim]) + shape[dim]) % shape[dim];
+                    }
+                }
+            }
+            if (in_lattice(neighbor)) {
+                map.neighborhood[neighbor] = rule.vicinity;
+            }
+        }
+    }
+
+    /**
+     * Generates the cell map of every cell of the lattice and adds the cells (see add_grid_cell_json).
+     * Cells listed in "cells" may replace part of the default state and configuration, the cell type, the delay, and
+     * the neighborhood.
+     */
+    void add_cells(nlohmann::json const &j) {
+        auto const &scenario = j.at("scenario");
+        bool wrapped = scenario.value("wrapped", false);
+        auto default_cell_type = scenario.at("default_cell_type").get<std::string>();
+        auto default_delay = scenario.value("default_delay", std::string("inertial"));
+        auto const &default_state = scenario.at("default_state");
+        auto const &default_config = scenario.at("default_config");
+        auto default_neighborhood = read_neighborhood(scenario.at("neighborhood"));
+
+        std::unordered_map<std::size_t, nlohmann::json const *> custom_cells;
+        if (j.contains("cells")) {
+            for (auto const &cell: j.at("cells")) {
+                auto location = cell.at("cell_id").get<cell_position>();
+                if (!in_lattice(location)) {
+                    throw std::out_of_range("cell " + position_name(location) + " is out of the lattice");
+                }
+                custom_cells[cell_index(location)] = &cell;
+            }
+        }
+
+        cell_map<sird, mc> map;
+        map.shape = shape;
+        map.wrapped = wrapped;
+        sird parsed_default_state = default_state.get<sird>();
+        for (std::size_t index = 0; index < n_cells(); index++) {
+            map.location = cell_location(index);
+            auto it = custom_cells.find(index);
+            if (it == custom_cells.end()) {
+                map.state = parsed_default_state;
+                set_neighborhood(map, default_neighborhood, wrapped);
+                add_grid_cell_json(default_cell_type, map, default_delay, default_config.at(default_cell_type));
+                continue;
+            }
+            auto const &cell = *it->second;
+            auto cell_type = cell.value("cell_type", default_cell_type);
+            nlohmann::json state = default_state;
+            state.merge_patch(cell.value("state", nlohmann::json::object()));
+            map.state = state.get<sird>();
+            nlohmann::json cell_config = default_config.at(cell_type);
+            cell_config.merge_patch(cell.value("config", nlohmann::json::object()));
+            set_neighborhood(map, cell.contains("neighborhood") ? read_neighborhood(cell.at("neighborhood")) : default_neighborhood, wrapped);
+            add_grid_cell_json(cell_type, map, cell.value("delay", default_delay), cell_config);
+        }
+    }
+
+    /// Cells of the lattice in row-major order. Cell models are shared with every copy of this coupled model
+    std::vector<std::shared_ptr<hoya_cell<T>>> const &lattice() {
+        if (cells.empty()) {
+            cells.resize(n_cells());
+            for (auto const &model: this->_models) {
+                auto cell = std::dynamic_pointer_cast<hoya_cell<T>>(model);
+                if (cell != nullptr) {
+                    cells[cell_index(cell->cell_id)] = cell;
+                }
+            }
+        }
+        return cells;
+    }
+
     void add_grid_cell_json(std::string const &cell_type, cell_map<sird, mc> &map, std::string const &delay_id,
                             nlohmann::json const &config) override {
         if (cell_type == "hoya_age") {
-            auto conf = config.get<typename hoya_cell<T>::config_type>();
-            this->template add_cell<hoya_cell>(map, delay_id, conf);
+            auto &conf = parse_config(config);  // cells copy what they need from it when they are built
+            conf.rand_gen = rand_gen;
+            conf.regions = regions;
+            conf.region_cell = cell_index(map.location);
+            if (regions != nullptr && (conf.lockdown_type == 4 || conf.lockdown_type == 5)) {
+                vicinity(map, map.location);  // the cell must listen to itself to wake up every time step
+            }
+            conf.adaptive = adaptive;
+            if (adaptive != nullptr) {
+                conf.fine_state = map.state;
+            }
+            if (initial_states != nullptr) {
+                map.state = initial_states->at(cell_index(map.location));
+            }
+            add_links(map);
+            if (adaptive != nullptr) {
+                pending.push_back({map, delay_id, conf});
+            } else {
+                add_neighbor_regions(map);
+                conf.quiescent = resumes_quiescent(map);
+                this->template add_cell<hoya_cell>(map, delay_id, conf);
+            }
         } else throw std::bad_typeid();
     }
 };
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PANDEMIC_HOYA_2002_HOYA_SIMULATION_HPP
+#define PANDEMIC_HOYA_2002_HOYA_SIMULATION_HPP
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <cadmium/modeling/dynamic_coupled.hpp>
+#include <cadmium/engine/pdevs_dynamic_runner.hpp>
+#include <cadmium/logger/common_loggers.hpp>
+#include "hoya_coupled.hpp"
+
+/// Number of people in each compartment of the whole lattice
+struct lattice_totals {
+    double population;
+    double susceptible;
+    double infected;
+    double recovered;
+    double deceased;
+
+    lattice_totals(): population(0), susceptible(0), infected(0), recovered(0), deceased(0) {}
+
+    [[nodiscard]] double infected_ratio() const {
+        return (population > 0)? infected / population : 0;
+    }
+
+    [[nodiscard]] double deceased_ratio() const {
+        return (population > 0)? deceased / population : 0;
+    }
+};
+
+/// State of a simulation at a given time step, from which other simulations of the same scenario can be restored
+struct simulation_snapshot {
+    int time;
+    std::vector<sird> states;  // states of every cell (row-major order)
+    std::vector<bool> changed;  // cells whose state changed in the last time step (row-major order)
+    std::default_random_engine rand_gen;  // random engine of the cells (see hoya_coupled::random_engine)
+};
+
+/**
+ * Simulation of a scenario that is advanced one time step at a time.
+ * Each simulation has its own random engine, seeded with the rand_seed of the scenario, and it does not log anything
+ * by default. Thus, several instances can run concurrently, and runs do not depend on the threads that run them.
+ */
+template <typename T, typename LOGGER = cadmium::logger::not_logger>
+class hoya_simulation {
+    static std::shared_ptr<hoya_coupled<T>> build(std::string const &scenario_path, nlohmann::json const &config_patch,
+                                                  std::shared_ptr<const simulation_snapshot> const &snapshot) {
+        auto model = std::make_shared<hoya_coupled<T>>("pandemic_hoya_age_json");
+        model->config_patch = config_patch;
+        if (snapshot != nullptr) {
+            model->config_patch["clock_offset"] = snapshot->time;
+            model->initial_states = {snapshot, &snapshot->states};
+            model->initial_changes = {snapshot, &snapshot->changed};
+        }
+        model->add_lattice_json(scenario_path);
+        model->couple_cells();
+        return model;
+    }
+
+public:
+    std::shared_ptr<hoya_coupled<T>> model;
+    cadmium::dynamic::engine::runner<T, LOGGER> runner;
+    int start_time;
+    int time;
+
+    explicit hoya_simulation(std::string const &scenario_path, nlohmann::json const &config_patch = nlohmann::json()):
+            model(build(scenario_path, config_patch, nullptr)), runner(model, {0}), start_time(0), time(0) {}
+
+    /**
+     * Restores a scenario from a snapshot of another simulation.
+     * The lattice is built again from the scenario file, and every cell copies its state from the snapshot.
+     * The random engine continues from the snapshot too. Cadmium evaluates every cell in the first step, so cells
+     * that the original simulation would not have evaluated (none of their neighbors changed) keep their state.
+     * Without configuration changes, the restored simulation is then identical to the original one.
+     * @param snapshot state of the other simulation, as returned by its snapshot() method.
+     */
+    hoya_simulation(std::string const &scenario_path, nlohmann::json const &config_patch,
+                    std::shared_ptr<const simulation_snapshot> const &snapshot):
+            model(build(scenario_path, config_patch, snapshot)), runner(model, {0}),
+            start_time(snapshot->time), time(snapshot->time) {
+        model->random_engine() = snapshot->rand_gen;
+    }
+
+    /// Processes every event of the current time step. Cells then hold their states of the next time step
+    void step() {
+        runner.run_until(++time - start_time);
+    }
+
+    /// Replaces a parameter of every cell from the current time step on (see hoya_cell::set_parameter)
+    void set_parameter(std::string const &name, nlohmann::json const &value) {
+        for (auto const &cell: model->lattice()) {
+            if (cell != nullptr) {
+                cell->set_parameter(name, value);
+            }
+        }
+    }
+
+    /**
+     * State of the simulation at the current time step.
+     * @param previous snapshot of the previous time step. It tells which cells changed in the last time step.
+     * Without it, every cell is considered changed, and every cell of a restored simulation is evaluated in its first
+     * step (which, with random factors, draws different random numbers than the original simulation).
+     */
+    [[nodiscard]] std::shared_ptr<const simulation_snapshot> snapshot(std::shared_ptr<const simulation_snapshot> const &previous = nullptr) {
+        auto res = std::make_shared<simulation_snapshot>();
+        res->time = time;
+        for (auto const &cell: model->lattice()) {
+            res->states.push_back((cell == nullptr)? sird() : cell->state.current_state);
+        }
+        bool compare = previous != nullptr && previous->time == time - 1 && time > start_time;
+        for (std::size_t i = 0; i < res->states.size(); i++) {
+            res->changed.push_back(!compare || res->states[i] != previous->states[i]);
+        }
+        res->rand_gen = model->random_engine();
+        return res;
+    }
+
+    [[nodiscard]] lattice_totals totals() {
+        lattice_totals res;
+        for (auto const &cell: model->lattice()) {
+            if (cell == nullptr) {
+                continue;
+            }
+            sird const &s = cell->state.current_state;
+            auto population = (double) s.population;
+            res.population += population;
+            res.susceptible += population * s.susceptible_ratio();
+            res.infected += population * s.infected_ratio();
+            res.recovered += population * s.recovered_ratio();
+            res.deceased += population * sird::sum_vector<float>(s.deceased);
+        }
+        return res;
+    }
+};
+
+#endif //PANDEMIC_HOYA_2002_HOYA_SIMULATION_HPP
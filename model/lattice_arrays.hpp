@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PANDEMIC_HOYA_2002_LATTICE_ARRAYS_HPP
+#define PANDEMIC_HOYA_2002_LATTICE_ARRAYS_HPP
+
+#include <memory>
+#include <vector>
+#include "cell/state.hpp"
+
+/**
+ * Contiguous copy of the state of every cell, for consumers that work with whole arrays (e.g., NumPy).
+ * Cell states live inside each cell model, so they are gathered here after every step.
+ * Buffers are allocated once and refreshed in place: views of them stay valid for the whole simulation.
+ * Compartments are stored as [age group][cell], with cells in row-major order.
+ */
+struct lattice_arrays {
+    std::size_t n_cells;
+    std::size_t n_ages;
+    std::vector<float> population;
+    std::vector<float> phase;
+    std::vector<float> susceptible;
+    std::vector<float> infected;
+    std::vector<float> recovered;
+    std::vector<float> deceased;
+
+    lattice_arrays(std::size_t cells, std::size_t ages): n_cells(cells), n_ages(ages), population(cells), phase(cells),
+            susceptible(cells * ages), infected(cells * ages), recovered(cells * ages), deceased(cells * ages) {}
+
+    template <typename CELLS>
+    void gather(CELLS const &lattice) {
+        for (std::size_t c = 0; c < n_cells; c++) {
+            if (lattice[c] == nullptr) {
+                continue;
+            }
+            sird const &s = lattice[c]->state.current_state;
+            population[c] = (float) s.population;
+            phase[c] = (float) s.phase;
+            for (std::size_t a = 0; a < n_ages && a < s.susceptible.size(); a++) {
+                susceptible[a * n_cells + c] = s.susceptible[a];
+                infected[a * n_cells + c] = s.infected[a];
+                recovered[a * n_cells + c] = s.recovered[a];
+                deceased[a * n_cells + c] = s.deceased[a];
+            }
+        }
+    }
+};
+
+#endif //PANDEMIC_HOYA_2002_LATTICE_ARRAYS_HPP
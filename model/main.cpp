@@ -25,11 +25,16 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <chrono>
+#include <csignal>
 #include <fstream>
+#include <memory>
 #include <cadmium/modeling/dynamic_coupled.hpp>
 #include <cadmium/engine/pdevs_dynamic_runner.hpp>
 #include <cadmium/logger/common_loggers.hpp>
 #include "hoya_coupled.hpp"
+#include "async_log_writer.hpp"
+#include "frame_renderer.hpp"
 
 using namespace std;
 using namespace cadmium;
@@ -37,17 +42,25 @@ using namespace cadmium::celldevs;
 
 using TIME = float;
 
+/// Seconds elapsed since a time point, which is then moved to the current time
+double lap(chrono::steady_clock::time_point &since) {
+    auto now = chrono::steady_clock::now();
+    double res = chrono::duration<double>(now - since).count();
+    since = now;
+    return res;
+}
+
 /*************** Loggers *******************/
-static ofstream out_messages("./simulation_results/output_messages.txt");
+static async_log_writer out_messages("./simulation_results/output_messages.txt");
 struct oss_sink_messages{
     static ostream& sink(){
-        return out_messages;
+        return out_messages.stream();
     }
 };
-static ofstream out_state("./simulation_results/state.txt");
+static async_log_writer out_state("./simulation_results/state.txt");
 struct oss_sink_state{
     static ostream& sink(){
-        return out_state;
+        return out_state.stream();
     }
 };
 
@@ -60,6 +73,7 @@ using logger_top=logger::multilogger<state, log_messages, global_time_mes, globa
 
 
 int main(int argc, char ** argv) {
+    async_log_writer::flush_on_signals({SIGINT, SIGTERM});
     cout << "CHECKPOINT 1";
     if (argc < 2) {
         cout << "Program used with wrong parameters. The program must be invoked as follows:";
@@ -68,15 +82,35 @@ int main(int argc, char ** argv) {
     }
 
     cout << "CHECKPOINT 2";
-    hoya_coupled<TIME> test = hoya_coupled<TIME>("pandemic_hoya_age_json");
+    auto start = chrono::steady_clock::now();
+    auto test = std::make_shared<hoya_coupled<TIME>>("pandemic_hoya_age_json");  // built in place: the model is never copied
     std::string scenario_config_file_path = argv[1];
-    test.add_lattice_json(scenario_config_file_path);
-    test.couple_cells();
+    std::ifstream scenario_file(scenario_config_file_path);
+    nlohmann::json scenario = nlohmann::json::parse(scenario_file);  // parsed once, for the lattice and the frames
+    test->add_lattice_json(scenario);
+    std::unique_ptr<frame_renderer> renderer;
+    if (scenario.contains("visualization")) {
+        renderer = std::make_unique<frame_renderer>(scenario["visualization"].get<frame_config>(), test->shape);
+    }
+    double lattice_time = lap(start);
+    test->couple_cells();
+    double coupling_time = lap(start);
 
-    std::shared_ptr<cadmium::dynamic::modeling::coupled<TIME>> t = std::make_shared<hoya_coupled<TIME>>(test);
+    cadmium::dynamic::engine::runner<TIME, logger_top> r(test, {0});
+    double engine_time = lap(start);
+    cout << endl << "Setup of " << test->n_cells() << " cells: lattice " << lattice_time << " s, coupling "
+         << coupling_time << " s, engine " << engine_time << " s" << endl;
 
-    cadmium::dynamic::engine::runner<TIME, logger_top> r(t, {0});
     float sim_time = (argc > 2)? atof(argv[2]) : 500;
-    r.run_until(sim_time);
+    if (renderer == nullptr) {
+        r.run_until(sim_time);
+    } else {
+        // Cells compute their next state when processing the events of a time step, so frames are captured before
+        for (int time = 0; time < sim_time; time++) {
+            renderer->capture(time, test->lattice());
+            r.run_until(std::min<float>(time + 1, sim_time));
+        }
+    }
+    cout << "Simulation: " << lap(start) << " s" << endl;
     return 0;
 }
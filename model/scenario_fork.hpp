@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PANDEMIC_HOYA_2002_SCENARIO_FORK_HPP
+#define PANDEMIC_HOYA_2002_SCENARIO_FORK_HPP
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "hoya_simulation.hpp"
+
+struct fork_config {
+    std::string scenario;
+    int fork_time;
+    int end_time;
+    std::string output_directory;
+    unsigned int threads;
+    std::map<std::string, nlohmann::json> branches;
+
+    fork_config(): fork_time(0), end_time(500), output_directory("./simulation_results/forks"), threads(0) {}
+};
+
+/// Branches are JSON merge patches of the cell configuration (e.g., { "lockdown_type": 3, "disobedience": [ ... ] })
+[[maybe_unused]] void from_json(const nlohmann::json& j, fork_config &v) {
+    j.at("scenario").get_to(v.scenario);
+    j.at("fork_time").get_to(v.fork_time);
+    j.at("end_time").get_to(v.end_time);
+    j.at("branches").get_to(v.branches);
+    if (j.contains("output_directory")) j.at("output_directory").get_to(v.output_directory);
+    if (j.contains("threads")) j.at("threads").get_to(v.threads);
+}
+
+/**
+ * Runs the scenario once until fork_time, and then every branch concurrently until end_time.
+ * Cadmium cannot clone a running simulation, so branches are not copy-on-write forks:
+ * every branch builds its own lattice and restores the state of the cells at fork_time from a snapshot.
+ * Only the snapshot is shared, and it is not modified by the branches. Forking saves simulating the prefix once
+ * per branch, but every branch takes the memory and setup time of a whole simulation.
+ */
+template <typename T>
+class scenario_fork {
+    fork_config config;
+
+    static void write_row(std::ofstream &out, int time, lattice_totals const &totals) {
+        double population = (totals.population > 0)? totals.population : 1;
+        out << time << "," << totals.susceptible / population << "," << totals.infected / population << ","
+            << totals.recovered / population << "," << totals.deceased / population << "\n";
+    }
+
+public:
+    explicit scenario_fork(fork_config c): config(std::move(c)) {}
+
+    /// Writes a CSV file per branch with the ratio of the total population in each compartment at every time step
+    void run() {
+        std::vector<std::pair<int, lattice_totals>> prefix;
+        std::shared_ptr<const simulation_snapshot> snapshot;
+        {
+            hoya_simulation<T> simulation(config.scenario);
+            std::shared_ptr<const simulation_snapshot> previous;
+            while (simulation.time < config.fork_time) {
+                prefix.emplace_back(simulation.time, simulation.totals());
+                if (simulation.time + 1 == config.fork_time) {
+                    previous = simulation.snapshot();
+                }
+                simulation.step();
+            }
+            snapshot = simulation.snapshot(previous);
+        }
+
+        std::filesystem::create_directories(config.output_directory);
+        std::vector<std::pair<std::string, nlohmann::json>> branches(config.branches.begin(), config.branches.end());
+        unsigned int n_threads = (config.threads > 0)? config.threads : std::max(1u, std::thread::hardware_concurrency());
+        std::atomic<std::size_t> next(0);
+        auto worker = [&] {
+            for (std::size_t i = next++; i < branches.size(); i = next++) {
+                std::ofstream out(std::filesystem::path(config.output_directory) / (branches[i].first + ".csv"));
+                out << "time,susceptible,infected,recovered,deceased\n";
+                for (auto const &[time, totals]: prefix) {
+                    write_row(out, time, totals);
+                }
+                hoya_simulation<T> simulation(config.scenario, branches[i].second, snapshot);
+                while (true) {
+                    write_row(out, simulation.time, simulation.totals());
+                    if (simulation.time >= config.end_time) {
+                        break;
+                    }
+                    simulation.step();
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < std::min<std::size_t>(n_threads, branches.size()); t++) {
+            workers.emplace_back(worker);
+        }
+        for (auto &w: workers) {
+            w.join();
+        }
+    }
+};
+
+#endif //PANDEMIC_HOYA_2002_SCENARIO_FORK_HPP
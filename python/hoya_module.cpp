@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include "../model/hoya_simulation.hpp"
+#include "../model/lattice_arrays.hpp"
+
+namespace py = pybind11;
+
+using TIME = float;
+
+/**
+ * Python wrapper of a simulation. NumPy arrays are views of its lattice_arrays, refreshed after every step.
+ * Steps run without the GIL, so the simulation has its own mutex: methods release the GIL before taking it.
+ */
+class python_simulation {
+    std::unique_ptr<hoya_simulation<TIME>> simulation;
+    std::unique_ptr<lattice_arrays> arrays;
+    mutable std::mutex mutex;
+
+    static nlohmann::json to_json(py::handle const &object) {
+        return nlohmann::json::parse(py::module_::import("json").attr("dumps")(object).cast<std::string>());
+    }
+
+public:
+    python_simulation(std::string const &scenario_path, py::object const &config_patch) {
+        nlohmann::json patch = config_patch.is_none()? nlohmann::json() : to_json(config_patch);
+        simulation = std::make_unique<hoya_simulation<TIME>>(scenario_path, patch);
+        auto const &lattice = simulation->model->lattice();
+        std::size_t n_ages = 0;
+        for (auto const &cell: lattice) {
+            if (cell != nullptr) {
+                n_ages = cell->n_age_segments();
+                break;
+            }
+        }
+        arrays = std::make_unique<lattice_arrays>(lattice.size(), n_ages);
+        arrays->gather(lattice);
+    }
+
+    [[nodiscard]] int time() const {
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(mutex);
+        return simulation->time;
+    }
+
+    void step(int n_steps) {
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < n_steps; i++) {
+            simulation->step();
+        }
+        arrays->gather(simulation->model->lattice());
+    }
+
+    void run_until(int time) {
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(mutex);
+        while (simulation->time < time) {
+            simulation->step();
+        }
+        arrays->gather(simulation->model->lattice());
+    }
+
+    void set_parameter(std::string const &name, py::object const &value) {
+        nlohmann::json parameter = to_json(value);
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(mutex);
+        simulation->set_parameter(name, parameter);  // std::invalid_argument is raised as ValueError
+    }
+
+    [[nodiscard]] py::dict totals() const {
+        lattice_totals t;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(mutex);
+            t = simulation->totals();
+        }
+        py::dict res;
+        res["population"] = t.population;
+        res["susceptible"] = t.susceptible;
+        res["infected"] = t.infected;
+        res["recovered"] = t.recovered;
+        res["deceased"] = t.deceased;
+        return res;
+    }
+
+    /**
+     * Read-only NumPy view of one of the buffers of the lattice arrays. The view keeps the simulation alive.
+     * @param by_age if true, the first dimension of the view is the age group, followed by the shape of the lattice.
+     */
+    static py::array view(py::object const &self, std::vector<float> lattice_arrays::*buffer, bool by_age) {
+        auto &s = self.cast<python_simulation &>();
+        std::vector<py::ssize_t> shape(s.simulation->model->shape.begin(), s.simulation->model->shape.end());
+        if (by_age) {
+            shape.insert(shape.begin(), (py::ssize_t) s.arrays->n_ages);
+        }
+        std::vector<py::ssize_t> strides(shape.size());
+        py::ssize_t stride = sizeof(float);
+        for (int dim = (int) shape.size() - 1; dim >= 0; dim--) {
+            strides[dim] = stride;
+            stride *= shape[dim];
+        }
+        py::array_t<float> res(shape, strides, ((*s.arrays).*buffer).data(), self);
+        res.attr("setflags")(py::arg("write") = false);
+        return res;
+    }
+};
+
+PYBIND11_MODULE(pyhoya, m) {
+    m.doc() = "In-process simulations of the Hoya Cell-DEVS model";
+    py::class_<python_simulation> simulation(m, "Simulation");
+    simulation.def(py::init<std::string const &, py::object const &>(), py::arg("scenario"), py::arg("config") = py::none(),
+                   "Loads a scenario. config replaces parameters of default_config.hoya_age (JSON merge patch)")
+            .def_property_readonly("time", &python_simulation::time)
+            .def("step", &python_simulation::step, py::arg("n_steps") = 1, "Advances the simulation n_steps time steps")
+            .def("run_until", &python_simulation::run_until, py::arg("time"), "Advances the simulation until the given time")
+            .def("set_parameter", &python_simulation::set_parameter, py::arg("name"), py::arg("value"),
+                 "Replaces a transition, capacity or mask parameter of every cell from now on")
+            .def("totals", &python_simulation::totals, "Number of people in each compartment of the whole lattice")
+            .def_property_readonly("population", [](py::object const &self) {
+                return python_simulation::view(self, &lattice_arrays::population, false);
+            }, "Population of every cell")
+            .def_property_readonly("phase", [](py::object const &self) {
+                return python_simulation::view(self, &lattice_arrays::phase, false);
+            }, "Lockdown phase of every cell")
+            .def_property_readonly("susceptible", [](py::object const &self) {
+                return python_simulation::view(self, &lattice_arrays::susceptible, true);
+            }, "Susceptible ratio of every age group and cell")
+            .def_property_readonly("infected", [](py::object const &self) {
+                return python_simulation::view(self, &lattice_arrays::infected, true);
+            }, "Infected ratio of every age group and cell")
+            .def_property_readonly("recovered", [](py::object const &self) {
+                return python_simulation::view(self, &lattice_arrays::recovered, true);
+            }, "Recovered ratio of every age group and cell")
+            .def_property_readonly("deceased", [](py::object const &self) {
+                return python_simulation::view(self, &lattice_arrays::deceased, true);
+            }, "Deceased ratio of every age group and cell");
+}
@@ -0,0 +1,63 @@
+"""
+Smoke test of the pyhoya module. It is run by ctest when the module is built (HOYA_BUILD_PYTHON=ON):
+
+    python pyhoya_test.py <scenario.json>
+
+It returns 0 if every check passes.
+"""
+import sys
+import threading
+
+import pyhoya
+
+failures = 0
+
+def check(condition, what):
+    global failures
+    if not condition:
+        print("FAILED: " + what, file=sys.stderr)
+        failures += 1
+
+def main(scenario):
+    sim = pyhoya.Simulation(scenario, {"lockdown_type": 2})
+    check(sim.time == 0, "simulations start at time 0")
+    population = sim.totals()["population"]
+    infected = sim.infected
+    check(infected.ndim == 3 and tuple(infected.shape[1:]) == tuple(sim.population.shape),
+          "ratios by age have one dimension for the age groups and the shape of the lattice")
+    check(not infected.flags.writeable, "views of the lattice are read-only")
+
+    sim.run_until(10)
+    check(sim.time == 10, "run_until stops at the given time")
+    totals = sim.totals()
+    check(abs(totals["population"] - population) < 1e-3 * population, "the population is conserved")
+    check(abs(float((infected * sim.population).sum()) - totals["infected"]) < 1e-2 * population,
+          "views are updated in place after every step")
+
+    try:
+        sim.set_parameter("virulence", [0.1])
+        check(False, "parameters without one value per age group are rejected")
+    except ValueError:
+        pass
+    sim.set_parameter("virulence", [0.0] * infected.shape[0])
+    sim.step(2)
+    check(sim.time == 12, "step advances the given number of time steps")
+
+    # simulations run in parallel from Python threads, and each one gives the same results as on its own
+    results = [None, None]
+    def run(i):
+        parallel = pyhoya.Simulation(scenario)
+        parallel.run_until(15)
+        results[i] = parallel.totals()
+    threads = [threading.Thread(target=run, args=(i,)) for i in range(2)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    alone = pyhoya.Simulation(scenario)
+    alone.run_until(15)
+    check(results[0] == alone.totals() and results[1] == alone.totals(), "parallel simulations are reproducible")
+
+if __name__ == "__main__":
+    main(sys.argv[1])
+    sys.exit(0 if failures == 0 else 1)
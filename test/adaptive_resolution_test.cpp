@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include "../model/hoya_simulation.hpp"
+#include "test_util.hpp"
+
+/// Regression tests for lattices with adaptive resolution
+
+test_scenario scenario(int side, float merge_threshold, std::vector<float> const &infected) {
+    test_scenario res;
+    res.side = side;
+    res.outbreak = {side / 4, side / 4};
+    res.infected = infected;
+    res.config = {{"virulence", {0.6, 0.6, 0.6, 0.6}}, {"recovery", {0.15, 0.15, 0.15, 0.15}}};
+    res.extra = {{"adaptive", {{"block", 8}, {"split_threshold", 0.05}, {"merge_threshold", merge_threshold},
+                               {"gradient_threshold", 0.01}}}};
+    return res;
+}
+
+/// Number of people in the compartments of every cell, which must match the population of the lattice
+double people(hoya_simulation<float> &simulation) {
+    double res = 0;
+    for (auto const &cell: simulation.model->lattice()) {
+        sird const &s = cell->state.current_state;
+        res += s.population * (s.susceptible_ratio() + s.infected_ratio() + s.recovered_ratio() + sird::sum_vector(s.deceased));
+    }
+    return res;
+}
+
+unsigned int aggregated_blocks(hoya_simulation<float> &simulation) {
+    unsigned int res = 0;
+    for (auto const &cell: simulation.model->lattice()) {
+        res += cell->state.current_state.aggregated();
+    }
+    return res;
+}
+
+/// People of every compartment (susceptible, infected, recovered, deceased) and age group of the block of a leader
+std::vector<double> block_people(hoya_simulation<float> &simulation, adaptive_resolution const &adaptive,
+                                 std::vector<int> const &leader) {
+    std::vector<double> res;
+    for (auto const &cell: simulation.model->lattice()) {
+        if (adaptive.leader(cell->cell_id) != leader) {
+            continue;
+        }
+        sird const &s = cell->state.current_state;
+        res.resize(4 * s.susceptible.size(), 0);
+        for (std::size_t i = 0; i < s.susceptible.size(); i++) {
+            res[i] += s.population * (double) s.susceptible[i];
+            res[s.susceptible.size() + i] += s.population * (double) s.infected[i];
+            res[2 * s.susceptible.size() + i] += s.population * (double) s.recovered[i];
+            res[3 * s.susceptible.size() + i] += s.population * (double) s.deceased[i];
+        }
+    }
+    return res;
+}
+
+/**
+ * Runs the scenario until the leader of some block announces the given change of resolution, stops the dynamics,
+ * and checks that handing people over keeps the people of every compartment and age group of the block.
+ * The tolerance is the rounding unit of a cell (population over precision).
+ */
+void check_hand_over(std::string const &path, unsigned int announcement, std::string const &what) {
+    hoya_simulation<float> simulation(path);
+    adaptive_resolution adaptive = nlohmann::json::parse(std::ifstream(path)).at("adaptive").get<adaptive_resolution>();
+    std::vector<int> leader;
+    while (leader.empty() && simulation.time < 250) {
+        simulation.step();
+        for (auto const &cell: simulation.model->lattice()) {
+            if (cell->state.current_state.block == announcement) {
+                leader = cell->cell_id;
+                break;
+            }
+        }
+    }
+    check(!leader.empty(), "some block announces that it " + what);
+    if (leader.empty()) {
+        return;
+    }
+    for (auto const &parameter: {"virulence", "recovery", "mortality"}) {
+        simulation.set_parameter(parameter, std::vector<float>(4, 0));
+    }
+    auto before = block_people(simulation, adaptive, leader);
+    simulation.step();
+    auto after = block_people(simulation, adaptive, leader);
+    float unit = 100 / 1000.0;  // population of a cell over its precision
+    bool exact = before.size() == after.size();
+    for (std::size_t i = 0; exact && i < before.size(); i++) {
+        exact = std::abs(before[i] - after[i]) <= unit;
+    }
+    check(exact, "every compartment and age group keeps its people when a block " + what);
+}
+
+int main() {
+    temporary_file file("adaptive_resolution_test");
+    {  // blocks split around the outbreak and merge back once it is over, without losing anybody
+        scenario(40, 0.03, {0.022, 0.061, 0.01, 0.007}).write(file.path);
+        hoya_simulation<float> simulation(file.path);
+        double population = simulation.totals().population;
+        unsigned int initial_blocks = aggregated_blocks(simulation);
+        check(initial_blocks == 24, "only the block with the outbreak starts split");
+        unsigned int min_blocks = initial_blocks;
+        bool conserved = true;
+        while (simulation.time < 250) {
+            simulation.step();
+            conserved = conserved && simulation.totals().population == population
+                        && std::abs(people(simulation) - population) < 1e-3 * population;
+            min_blocks = std::min(min_blocks, aggregated_blocks(simulation));
+        }
+        check(conserved, "the population of the lattice is conserved at every time step");
+        check(min_blocks < initial_blocks, "blocks split when the outbreak reaches them");
+        check(aggregated_blocks(simulation) > min_blocks, "blocks merge again when the outbreak is over");
+    }
+    {  // splitting and merging blocks only hand people over between the leader and its members
+        // blocks only split when their own infected ratio is high, so they have people in every compartment by then
+        auto hand_over = scenario(40, 0.03, {0.022, 0.061, 0.01, 0.007});
+        hand_over.config["mortality"] = {0.01, 0.01, 0.02, 0.05};
+        hand_over.extra["adaptive"]["split_threshold"] = 0.1;
+        hand_over.extra["adaptive"]["gradient_threshold"] = 1.0;
+        hand_over.write(file.path);
+        check_hand_over(file.path, splitting_block, "splits");
+        check_hand_over(file.path, merging_block, "merges");
+    }
+    {  // aggregated blocks round their ratios to people of a single cell, not to ratios of a single cell
+        scenario(8, 0.03, {0, 0.02, 0, 0}).write(file.path);
+        hoya_simulation<float> simulation(file.path);
+        check(aggregated_blocks(simulation) == 1, "the block of a small outbreak starts aggregated");
+        simulation.step();
+        check(simulation.totals().infected > 1, "the infected people of an aggregated block are not rounded away");
+    }
+    {  // blocks could never merge again if cells cannot recover from their residual infections
+        scenario(40, 0.005, {0.022, 0.061, 0.01, 0.007}).write(file.path);
+        bool rejected = false;
+        try {
+            hoya_simulation<float> simulation(file.path);
+        } catch (std::invalid_argument const &) {
+            rejected = true;
+        }
+        check(rejected, "merge thresholds below the rounding residual are rejected");
+    }
+    return test_result();
+}
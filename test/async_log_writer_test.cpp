@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../model/async_log_writer.hpp"
+
+/**
+ * Regression test for the emergency flush of async_log_writer.
+ * A child process logs into a FIFO that is read slowly, so its buffers are queued or in flight when it receives
+ * SIGTERM. The file must then hold the first records in order, without duplicates or torn records.
+ */
+
+std::string record(long i) {
+    return "record " + std::to_string(i) + " " + std::string(i % 23, 'x');
+}
+
+[[noreturn]] void log_forever(std::string const &fifo_path) {
+    async_log_writer::flush_on_signals({SIGTERM});
+    async_log_writer writer(fifo_path, 64, 2);  // records do not fit evenly in such small buffers
+    for (long i = 0;; i++) {
+        writer.stream() << record(i) << std::endl;
+    }
+}
+
+bool check_log(std::string const &log) {
+    if (log.empty() || log.back() != '\n') {
+        std::cerr << "the log does not end with a complete record" << std::endl;
+        return false;
+    }
+    std::istringstream lines(log);
+    long expected = 0;
+    for (std::string line; std::getline(lines, line); expected++) {
+        if (line != record(expected)) {
+            std::cerr << "record " << expected << " is wrong: " << line << std::endl;
+            return false;
+        }
+    }
+    return expected > 0;
+}
+
+bool run(std::string const &fifo_path, int reads_before_signal) {
+    pid_t child = fork();
+    if (child == 0) {
+        log_forever(fifo_path);
+    }
+    int fd = open(fifo_path.c_str(), O_RDONLY);
+    std::string log;
+    char chunk[16];
+    for (int i = 0; i < reads_before_signal; i++) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n > 0) {
+            log.append(chunk, n);
+        }
+        usleep(200);
+    }
+    kill(child, SIGTERM);
+    for (ssize_t n; (n = read(fd, chunk, sizeof(chunk))) > 0;) {
+        log.append(chunk, n);
+    }
+    close(fd);
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 128 + SIGTERM) {
+        std::cerr << "the writer did not exit through the signal watcher" << std::endl;
+        return false;
+    }
+    return check_log(log);
+}
+
+int main() {
+    std::string fifo_path = "async_log_writer_test." + std::to_string(getpid()) + ".fifo";
+    if (mkfifo(fifo_path.c_str(), 0600) != 0) {
+        std::cerr << "unable to create " << fifo_path << std::endl;
+        return 1;
+    }
+    bool ok = true;
+    for (int reads = 1; reads < 200 && ok; reads += 7) {
+        ok = run(fifo_path, reads);
+    }
+    unlink(fifo_path.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../model/frame_renderer.hpp"
+#include "test_util.hpp"
+
+/// Regression tests for the frames rendered from the lattice
+
+/// Stand-in of a cell model: the renderer only reads the current state of the cells
+struct test_cell {
+    struct {
+        sird current_state;
+    } state;
+};
+
+int main() {
+    {  // fields are validated when the configuration is read
+        bool rejected = false;
+        try {
+            nlohmann::json({{"field", "infectd"}}).get<frame_config>();
+        } catch (std::invalid_argument const &) {
+            rejected = true;
+        }
+        check(rejected, "unknown fields are rejected");
+        auto config = nlohmann::json({{"field", "recovered"}}).get<frame_config>();
+        check(config.colors.at(1) == "#2ecc71", "each field has its own default colors");
+    }
+    {  // frames are numbered consecutively, and keep the simulation time in a comment
+        std::string directory = "frame_renderer_test." + std::to_string(getpid());
+        frame_config config;
+        config.directory = directory;
+        config.every = 2;
+        std::vector<std::shared_ptr<test_cell>> lattice;
+        for (int i = 0; i < 6; i++) {
+            lattice.push_back(std::make_shared<test_cell>());
+        }
+        {
+            frame_renderer renderer(config, {2, 3});
+            for (int time = 0; time < 5; time++) {
+                renderer.capture(time, lattice);
+            }
+        }  // the destructor waits for every frame to be written
+        std::ifstream frame(std::filesystem::path(directory) / "frame_000001.ppm");
+        std::string magic, hash, word, time;
+        unsigned int width = 0, height = 0;
+        frame >> magic >> hash >> word >> time >> width >> height;  // P6, "# time T", width and height
+        check(magic == "P6" && time == "2", "the second frame is the one of time 2");
+        check(width == 12 && height == 8, "frames are scaled from the shape of the lattice");
+        check(!std::filesystem::exists(std::filesystem::path(directory) / "frame_000003.ppm"), "only every other time is rendered");
+        std::filesystem::remove_all(directory);
+    }
+    return test_result();
+}
@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <vector>
+#include "../model/hoya_simulation.hpp"
+#include "test_util.hpp"
+
+/// Regression tests for running several simulations in the same process
+
+std::vector<double> infected_curve(std::string const &path, int end_time) {
+    hoya_simulation<float> simulation(path);
+    std::vector<double> res;
+    while (simulation.time < end_time) {
+        simulation.step();
+        res.push_back(simulation.totals().infected);
+    }
+    return res;
+}
+
+int main() {
+    temporary_file file("hoya_simulation_test");
+    test_scenario scenario;
+    scenario.config = {{"rand_type", 1}};
+    scenario.write(file.path);
+    auto alone = infected_curve(file.path, 20);
+    check(infected_curve(file.path, 20) == alone, "runs of a scenario with random factors are reproducible");
+
+    // simulations built and stepped in turns on the same thread do not share their random numbers
+    hoya_simulation<float> first(file.path);
+    std::vector<double> interleaved;
+    while (first.time < 20) {
+        hoya_simulation<float> other(file.path);
+        other.step();
+        first.step();
+        interleaved.push_back(first.totals().infected);
+    }
+    check(interleaved == alone, "simulations in the same thread are independent");
+
+    scenario.config["rand_seed"] = 42;
+    scenario.write(file.path);
+    check(infected_curve(file.path, 20) != alone, "the random engine is seeded with rand_seed");
+    return test_result();
+}
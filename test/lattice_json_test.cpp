@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "../model/hoya_simulation.hpp"
+#include "test_util.hpp"
+
+/// Regression tests for the cell maps generated from the shape and the neighborhood of a scenario
+
+std::size_t n_neighbors(hoya_simulation<float> &simulation, std::size_t cell) {
+    return simulation.model->lattice().at(cell)->neighbors.size();
+}
+
+bool has_neighbor(hoya_simulation<float> &simulation, std::size_t cell, cell_position const &neighbor) {
+    auto const &neighbors = simulation.model->lattice().at(cell)->neighbors;
+    return std::find(neighbors.begin(), neighbors.end(), neighbor) != neighbors.end();
+}
+
+int main() {
+    temporary_file file("lattice_json_test");
+    test_scenario scenario;
+    scenario.side = 5;
+    scenario.outbreak = {2, 2};
+    {  // von Neumann neighborhoods include the cell itself, and lose the neighbors out of the lattice
+        scenario.write(file.path);
+        hoya_simulation<float> simulation(file.path);
+        check(n_neighbors(simulation, 2 * 5 + 2) == 5, "von Neumann neighborhood of range 1");
+        check(n_neighbors(simulation, 0) == 3, "corner cells have no neighbors out of the lattice");
+        check(has_neighbor(simulation, 0, {0, 0}) && has_neighbor(simulation, 0, {1, 0}), "neighbors of a corner cell");
+    }
+    {  // wrapped lattices move the neighbors out of the lattice to the other side
+        auto j = scenario.to_json();
+        j["scenario"]["wrapped"] = true;
+        j["scenario"]["neighborhood"][0]["type"] = "moore";
+        j["scenario"]["neighborhood"][0]["range"] = 2;
+        std::ofstream(file.path) << j;
+        hoya_simulation<float> simulation(file.path);
+        check(n_neighbors(simulation, 0) == 25, "Moore neighborhood of range 2 on a wrapped lattice");
+        check(has_neighbor(simulation, 0, {4, 3}), "wrapped neighbors of a corner cell");
+    }
+    {  // listed cells replace part of the default state, configuration and neighborhood
+        auto j = scenario.to_json();
+        j["cells"].push_back({{"cell_id", {0, 4}}, {"state", {{"population", 50}}}, {"config", {{"lockdown_type", 2}}},
+                              {"neighborhood", {{{"type", "relative"}, {"neighbors", {{0, 0}, {0, -4}}},
+                                                 {"vicinity", {{"connection", {1, 1, 1, 1}}, {"movement", {1, 1, 1, 1}}}}}}}});
+        std::ofstream(file.path) << j;
+        hoya_simulation<float> simulation(file.path);
+        auto const &cell = simulation.model->lattice().at(4);
+        check(cell->state.current_state.population == 50, "listed cells replace part of the default state");
+        check(cell->state.current_state.susceptible_ratio() > 0.99, "the rest of the default state is kept");
+        check(cell->lockdown_type == 2, "listed cells replace part of the default configuration");
+        check(n_neighbors(simulation, 4) == 2 && has_neighbor(simulation, 4, {0, 0}), "listed cells may have their own neighborhood");
+        check(simulation.model->lattice().at(3)->lockdown_type == 0, "other cells keep the default configuration");
+    }
+    {  // cells out of the lattice are rejected
+        auto j = scenario.to_json();
+        j["cells"].push_back({{"cell_id", {5, 0}}});
+        std::ofstream(file.path) << j;
+        bool rejected = false;
+        try {
+            hoya_simulation<float> simulation(file.path);
+        } catch (std::out_of_range const &) {
+            rejected = true;
+        }
+        check(rejected, "cells out of the lattice are rejected");
+    }
+    return test_result();
+}
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include "../tools/log_reducer.hpp"
+#include "test_util.hpp"
+
+/// Regression tests for the index and the parser of the native log reducer
+
+std::string record(int x, int y, float infected) {
+    return "[cell_out: {(" + std::to_string(x) + "," + std::to_string(y) + ") ; <100,0," + std::to_string(1 - infected) +
+           "," + std::to_string(infected) + ",0,0," + std::to_string(1 - infected) + "," + std::to_string(infected) +
+           ",0,0>}] generated by model cell_(" + std::to_string(x) + "," + std::to_string(y) + ")\n";
+}
+
+void write_file(std::string const &path, std::string const &content) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+int main() {
+    std::string log_path = "log_reducer_test." + std::to_string(getpid()) + ".txt";
+    std::string index_path = log_path + ".index";
+    std::string log = "0\n" + record(0, 0, 0.5f) + "1\n" + record(0, 1, 0.25f) + record(1, 1, 1) + "2\n" + record(0, 0, 0);
+    write_file(log_path, log);
+
+    {  // aggregates of a 2x2 lattice, where cells that were never logged are susceptible
+        mapped_log mapped(log_path);
+        log_reducer reducer(mapped, {2, 2}, 2);
+        auto steps = reducer.index();
+        check(steps.size() == 3, "three time steps are indexed");
+        auto aggregates = reducer.reduce(steps);
+        check(aggregates.size() == 3, "one row per time step");
+        check(std::abs(aggregates[0].infected - 0.125) < 1e-6, "infected ratio of the first time step");
+        check(std::abs(aggregates[1].infected - 0.4375) < 1e-6, "infected ratio of the second time step");
+        check(std::abs(aggregates[2].infected_population - 125) < 1e-3, "infected people of the last time step");
+
+        check(find_step(steps, parse_time("1.0")) == &steps[1], "steps are looked up by the value of their time");
+        check(find_step(steps, 3) == nullptr, "missing times are not found");
+
+        write_index(index_path, mapped, steps);
+        auto read = read_index(index_path, mapped);
+        check(read.size() == steps.size() && read.back().offset == steps.back().offset &&
+              read.back().length == steps.back().length, "the index is read back");
+    }
+    {  // an index whose log was truncated afterwards is stale
+        write_file(log_path, log.substr(0, log.size() / 2));
+        mapped_log mapped(log_path);
+        check(read_index(index_path, mapped).empty(), "a stale index is discarded");
+    }
+    {  // an index with the right log metadata but entries out of the log is discarded too
+        mapped_log mapped(log_path);
+        write_file(index_path, "log_size,log_modification_time\n" + std::to_string(mapped.size()) + "," +
+                               std::to_string(mapped.modification_time()) + "\ntime,offset,length\n0,0,999999\n");
+        check(read_index(index_path, mapped).empty(), "out of bounds entries are rejected");
+    }
+    {  // a truncated final record is ignored instead of being read past the end of the mapping
+        write_file(log_path, "0\n" + record(0, 0, 0.5f) + "1\n[cell_out: {(1,0) ; <100,0,0.5");
+        mapped_log mapped(log_path);
+        log_reducer reducer(mapped, {2, 2}, 1);
+        auto steps = reducer.index();
+        check(steps.size() == 2 && reducer.records(steps.back()).empty(), "the truncated record is skipped");
+        auto aggregates = reducer.reduce(steps);
+        check(aggregates.size() == 2 && std::abs(aggregates[1].infected - 0.125) < 1e-6, "the truncated record does not count");
+    }
+    {  // running totals do not drift after many small changes to a large total
+        compensated_sum sum(1e8);
+        for (int i = 0; i < 1000000; i++) {
+            sum.add(1e-3);
+        }
+        check(std::abs(sum.value() - (1e8 + 1e3)) < 1e-6, "compensated sums keep small changes");
+    }
+    std::remove(log_path.c_str());
+    std::remove(index_path.c_str());
+    return test_result();
+}
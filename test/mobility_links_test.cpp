@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdexcept>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "../model/hoya_simulation.hpp"
+#include "test_util.hpp"
+
+/// Regression tests for the long-range links of a scenario
+
+int main() {
+    temporary_file file("mobility_links_test");
+    test_scenario scenario;
+    scenario.extra = {{"links", {{{"from", {6, 6}}, {"to", {0, 0}}, {"weight", {1, 1, 1, 1}}}}}};
+    scenario.write(file.path);
+    hoya_simulation<float> linked(file.path);
+    while (linked.time < 3) {
+        linked.step();
+    }
+    check(linked.snapshot()->states.at(0).infected_ratio() > 0, "a link infects a distant cell before the neighborhood does");
+
+    scenario.extra["links"][0]["weight"] = {1, 1};
+    scenario.write(file.path);
+    std::string message;
+    try {
+        hoya_simulation<float> wrong(file.path);
+    } catch (std::invalid_argument const &e) {
+        message = e.what();
+    }
+    check(!message.empty(), "a link without one weight per age group is rejected");
+    check(message.find("[6,6]") != std::string::npos && message.find("[0,0]") != std::string::npos,
+          "the error names the link (" + message + ")");
+    return test_result();
+}
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <cmath>
+#include <vector>
+#include "../model/hoya_simulation.hpp"
+#include "test_util.hpp"
+
+/// Regression tests for regional lockdowns and the region monitor they share
+
+sird state(unsigned int population, float infected) {
+    std::vector<float> s = {1 - infected}, i = {infected}, r = {0}, d = {0};
+    return sird(population, s, i, r, d);
+}
+
+int main() {
+    {  // the monitor only counts the states that hold at the time of the reduction
+        region_monitor monitor({0, 0, 1, 1});
+        monitor.publish(0, state(100, 0.5f), 0);
+        monitor.publish(1, state(100, 0), 0);
+        monitor.publish(2, state(50, 0.2f), 0);
+        monitor.publish(3, state(0, 0), 0);
+        monitor.reduce(0);
+        check(std::abs(monitor.infected_ratio(0) - 0.25f) < 1e-6, "infected ratio of the first region");
+        check(std::abs(monitor.infected_ratio(1) - 0.2f) < 1e-6, "infected ratio of the second region");
+
+        monitor.publish(1, state(100, 0.5f), 1);
+        monitor.reduce(0);
+        check(std::abs(monitor.infected_ratio(0) - 0.25f) < 1e-6, "states of the next time step are not counted yet");
+        monitor.publish(1, state(100, 0.1f), 1);  // the cell computes its state for the next time step again
+        monitor.reduce(1);
+        check(std::abs(monitor.infected_ratio(0) - 0.3f) < 1e-6, "only the last state published for a time step counts");
+        check(std::abs(monitor.infected_ratio(1) - 0.2f) < 1e-6, "regions without changes keep their ratio");
+    }
+
+    temporary_file file("region_monitor_test");
+    test_scenario scenario;
+    scenario.outbreak = {1, 1};
+    // the region starts below the threshold of the first phase, so cells only enter it once the outbreak has grown
+    scenario.config = {{"lockdown_type", 5}, {"phase_thresholds", {0.0, 0.003, 0.9}}, {"threshold_buffers", {0.0, 0.0, 0.0}}};
+    {  // cells far from the outbreak enter the lockdown of their region even though nothing changes around them
+        scenario.write(file.path);
+        hoya_simulation<float> simulation(file.path);
+        auto const &far_cell = simulation.model->lattice().back();
+        auto const &far = far_cell->state.current_state;
+        check(far.phase == 0, "the region starts below the threshold");
+        while (far_cell->regions->infected_ratio(0) < 0.003 && simulation.time < 50) {
+            simulation.step();
+        }
+        simulation.step();  // the cells compute their phase with the ratio of the region that crossed the threshold
+        simulation.step();  // and their new phase is output
+        check(far.infected_ratio() == 0, "the outbreak has not reached the far cell");
+        check(far.phase == 1, "the far cell reacts to the infected ratio of its region");
+    }
+    {  // the strength of a continuous lockdown depends on the region of the infected cell, not of the cell it infects
+        test_scenario split;
+        split.outbreak = {5, 6};  // last row of the first region: one neighbor is in each region
+        split.config = {{"lockdown_type", 4}, {"lockdown_adoption", 300.0}};
+        std::vector<std::vector<int>> raster(12);
+        for (int row = 0; row < 12; row++) {
+            raster[row] = std::vector<int>(12, (row < 6) ? 0 : 1);
+        }
+        split.extra = {{"regions", raster}};
+        split.write(file.path);
+        hoya_simulation<float> simulation(file.path);
+        simulation.step();
+        simulation.step();
+        auto const &lattice = simulation.model->lattice();
+        float same_region = lattice.at(4 * 12 + 6)->state.current_state.infected_ratio();
+        float other_region = lattice.at(6 * 12 + 6)->state.current_state.infected_ratio();
+        check(same_region > 0, "the outbreak spreads to its neighbors");
+        check(same_region == other_region, "neighbors in different regions receive the same spread from the outbreak");
+    }
+    {  // without regional lockdowns, no monitor is built
+        scenario.config["lockdown_type"] = 3;
+        scenario.write(file.path);
+        hoya_simulation<float> simulation(file.path);
+        check(simulation.model->lattice().back()->regions == nullptr, "scenarios without regional lockdowns have no monitor");
+    }
+    return test_result();
+}
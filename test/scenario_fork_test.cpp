@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "../model/hoya_simulation.hpp"
+#include "test_util.hpp"
+
+/// Regression tests for restoring a scenario from a snapshot (used by hoya_fork)
+
+int main() {
+    temporary_file file("scenario_fork_test");
+    // lockdown type 1 checks that scheduled phases stay aligned with the scenario time.
+    // rand_type 1 checks that cells which would not be evaluated after the snapshot do not draw random numbers
+    for (auto const &config: {nlohmann::json{{"lockdown_type", 0}}, nlohmann::json{{"lockdown_type", 1}},
+                              nlohmann::json{{"rand_type", 1}}}) {
+        test_scenario scenario;
+        scenario.config = config;
+        scenario.write(file.path);
+        std::string what = " (" + config.dump() + ")";
+
+        hoya_simulation<float> straight(file.path);
+        std::vector<double> infected, deceased;
+        while (straight.time <= 30) {
+            infected.push_back(straight.totals().infected);
+            deceased.push_back(straight.totals().deceased);
+            straight.step();
+        }
+
+        hoya_simulation<float> prefix(file.path);
+        std::shared_ptr<const simulation_snapshot> previous;
+        while (prefix.time < 12) {
+            previous = prefix.snapshot();
+            prefix.step();
+        }
+        auto snapshot = prefix.snapshot(previous);
+        check(snapshot->time == 12, "the snapshot records its time" + what);
+
+        hoya_simulation<float> branch(file.path, nlohmann::json(), snapshot);
+        bool same = branch.time == 12;
+        while (same && branch.time <= 30) {
+            same = branch.totals().infected == infected[branch.time] && branch.totals().deceased == deceased[branch.time];
+            branch.step();
+        }
+        check(same, "a branch without changes continues the original simulation" + what);
+
+        hoya_simulation<float> changed(file.path, {{"virulence", {0.1, 0.1, 0.1, 0.1}}}, snapshot);
+        changed.step();
+        changed.step();
+        check(changed.totals().infected < infected[14], "the parameters of a branch apply from the snapshot on" + what);
+    }
+    return test_result();
+}
@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef PANDEMIC_HOYA_2002_TEST_UTIL_HPP
+#define PANDEMIC_HOYA_2002_TEST_UTIL_HPP
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+
+/// Helpers shared by the regression tests. Each test is an executable that returns 0 if every check passes
+
+inline int failures = 0;
+
+inline void check(bool condition, std::string const &what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+inline int test_result() {
+    return failures == 0 ? 0 : 1;
+}
+
+/// File of a test, named after the test and the process so tests can run concurrently. It is removed when destroyed
+struct temporary_file {
+    std::string path;
+
+    explicit temporary_file(std::string const &name, std::string const &extension = "json"):
+            path(name + "." + std::to_string(getpid()) + "." + extension) {}
+
+    ~temporary_file() {
+        std::remove(path.c_str());
+    }
+};
+
+/**
+ * Square lattice with the parameters of config/scenario.json, no randomness, and a single cell with an outbreak.
+ * Tests change what they need through the configuration patch and the extra top-level keys.
+ */
+struct test_scenario {
+    int side = 12;
+    std::vector<int> outbreak = {6, 6};
+    std::vector<float> infected = {0.022, 0.061, 0.01, 0.007};  // infected ratios of the outbreak cell
+    nlohmann::json config;  // JSON merge patch of the default cell configuration (e.g., {"lockdown_type": 5})
+    nlohmann::json extra;   // top-level keys next to "scenario" and "cells" (e.g., "regions", "links" or "adaptive")
+
+    [[nodiscard]] nlohmann::json to_json() const {
+        nlohmann::json cell_config = {{"susceptibility", {0.093, 0.296, 0.151, 0.178}}, {"virulence", {0.23, 0.23, 0.23, 0.23}},
+                                      {"recovery", {0.065, 0.065, 0.065, 0.065}}, {"mortality", {0, 0.0016, 0.0178, 0.0543}},
+                                      {"infected_capacity", 0.2}, {"over_capacity_modifier", 2.0},
+                                      {"mask_use", {0.67, 0.75, 0.95, 1.0}}, {"mask_susceptibility_reduction", 0.1},
+                                      {"mask_virulence_reduction", 1.0}, {"mask_adoption", 5.0}, {"lockdown_type", 0},
+                                      {"lockdown_rates", {{1, 1, 1, 1}, {0.5, 0.5, 0.5, 0.5}, {0.33, 0.33, 0.33, 0.33}}},
+                                      {"phase_durations", {5, 10, 999}}, {"lockdown_adoption", 1.0},
+                                      {"phase_thresholds", {0.0, 0.05, 0.1}}, {"threshold_buffers", {0.0, 0.02, 0.05}},
+                                      {"disobedience", {0, 0, 0, 0}}, {"rand_type", 0}, {"rand_mean", 1.0}, {"rand_stddev", 0.3},
+                                      {"rand_upper", 2.0}, {"rand_lower", 0.5}, {"rand_avg_occurence_rate", 1.5},
+                                      {"rand_seed", 1337.42}, {"precision", 1000}};
+        if (config.is_object()) {  // merging null would remove the whole configuration
+            cell_config.merge_patch(config);
+        }
+        std::vector<float> default_susceptible = {0.22, 0.61, 0.1, 0.07}, susceptible, empty(4, 0);
+        for (std::size_t i = 0; i < default_susceptible.size(); i++) {
+            susceptible.push_back(default_susceptible[i] - infected.at(i));
+        }
+        nlohmann::json res = {
+            {"scenario", {{"shape", {side, side}}, {"wrapped", false}, {"default_delay", "inertial"},
+                          {"default_cell_type", "hoya_age"},
+                          {"default_state", {{"population", 100}, {"susceptible", default_susceptible},
+                                             {"infected", empty}, {"recovered", empty}, {"deceased", empty}}},
+                          {"default_config", {{"hoya_age", cell_config}}},
+                          {"neighborhood", {{{"type", "von_neumann"}, {"range", 1},
+                                             {"vicinity", {{"connection", {1, 1, 1, 1}}, {"movement", {1, 1, 1, 1}}}}}}}}},
+            {"cells", {{{"cell_id", outbreak}, {"state", {{"population", 100}, {"susceptible", susceptible},
+                                                           {"infected", infected}, {"recovered", empty},
+                                                           {"deceased", empty}}}}}}};
+        if (extra.is_object()) {
+            res.update(extra);
+        }
+        return res;
+    }
+
+    void write(std::string const &path) const {
+        std::ofstream(path) << to_json();
+    }
+};
+
+#endif //PANDEMIC_HOYA_2002_TEST_UTIL_HPP
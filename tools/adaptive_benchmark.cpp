@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "../model/hoya_simulation.hpp"
+
+using namespace std;
+
+/**
+ * Simulates a square version of a scenario with and without adaptive resolution, and reports the time of each run.
+ * The scenario keeps its configuration and the cells that fit in the new shape.
+ */
+
+struct run_result {
+    double setup_time;
+    double simulation_time;
+    lattice_totals totals;
+};
+
+run_result run(nlohmann::json const &scenario, string const &path, int steps) {
+    ofstream(path) << scenario;
+    auto begin = chrono::steady_clock::now();
+    hoya_simulation<float> simulation(path);
+    auto built = chrono::steady_clock::now();
+    while (simulation.time < steps) {
+        simulation.step();
+    }
+    auto end = chrono::steady_clock::now();
+    std::remove(path.c_str());
+    return {chrono::duration<double>(built - begin).count(), chrono::duration<double>(end - built).count(), simulation.totals()};
+}
+
+void print(string const &name, run_result const &r) {
+    cout << name << ": setup " << r.setup_time << " s, simulation " << r.simulation_time << " s (infected "
+         << r.totals.infected << ", deceased " << r.totals.deceased << ")" << endl;
+}
+
+int main(int argc, char ** argv) {
+    if (argc < 4) {
+        cout << "Program used with wrong parameters. The program must be invoked as follows:" << endl;
+        cout << argv[0] << " SCENARIO.json SIDE STEPS [ADAPTIVE (default: {\"block\": 8, \"split_threshold\": 0.05, "
+                           "\"merge_threshold\": 0.03, \"gradient_threshold\": 0.01})]" << endl;
+        return -1;
+    }
+    nlohmann::json scenario = nlohmann::json::parse(ifstream(argv[1]));
+    int side = stoi(argv[2]);
+    int steps = stoi(argv[3]);
+    nlohmann::json adaptive = (argc > 4) ? nlohmann::json::parse(argv[4]) :
+            nlohmann::json{{"block", 8}, {"split_threshold", 0.05}, {"merge_threshold", 0.03}, {"gradient_threshold", 0.01}};
+
+    scenario["scenario"]["shape"] = {side, side};
+    nlohmann::json cells = nlohmann::json::array();
+    for (auto const &cell: scenario.value("cells", nlohmann::json::array())) {
+        auto const &id = cell.at("cell_id");
+        if (id.at(0).get<int>() < side && id.at(1).get<int>() < side) {
+            cells.push_back(cell);
+        }
+    }
+    scenario["cells"] = cells;
+    scenario.erase("adaptive");
+
+    string path = "adaptive_benchmark." + to_string(side) + ".json";
+    auto fine = run(scenario, path, steps);
+    scenario["adaptive"] = adaptive;
+    auto coarse = run(scenario, path, steps);
+
+    cout << side << "x" << side << " cells, " << steps << " time steps" << endl;
+    print("Fine lattice", fine);
+    print("Adaptive resolution", coarse);
+    cout << "Speed-up of the simulation: " << fine.simulation_time / coarse.simulation_time << endl;
+    return 0;
+}
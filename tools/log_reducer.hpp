@@ -0,0 +1,417 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PANDEMIC_HOYA_2002_LOG_REDUCER_HPP
+#define PANDEMIC_HOYA_2002_LOG_REDUCER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// Read-only memory mapping of a whole log file
+class mapped_log {
+    int fd;
+    const char *mapping;
+    std::size_t length;
+    long long modified;  // modification time, in nanoseconds
+public:
+    explicit mapped_log(std::string const &file_path) : fd(-1), mapping(nullptr), length(0), modified(0) {
+        fd = open(file_path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("unable to open " + file_path);
+        }
+        struct stat info{};
+        fstat(fd, &info);
+        length = info.st_size;
+        modified = (long long) info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+        if (length > 0) {
+            void *m = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("unable to map " + file_path);
+            }
+            madvise(m, length, MADV_SEQUENTIAL);
+            mapping = static_cast<const char *>(m);
+        }
+    }
+
+    mapped_log(mapped_log const &) = delete;
+    mapped_log &operator = (mapped_log const &) = delete;
+
+    ~mapped_log() {
+        if (mapping != nullptr) {
+            munmap(const_cast<char *>(mapping), length);
+        }
+        close(fd);
+    }
+
+    [[nodiscard]] const char *data() const { return mapping; }
+    [[nodiscard]] std::size_t size() const { return length; }
+    [[nodiscard]] long long modification_time() const { return modified; }
+};
+
+/// Byte range of the records logged at one simulation time. The range starts at the line with the time
+struct time_step {
+    std::string time;
+    std::size_t offset;
+    std::size_t length;
+    double value;  // time as a number, to look steps up without comparing strings
+};
+
+/// Numeric value of a time line (NaN if it is not a number)
+[[nodiscard]] double parse_time(std::string const &time) {
+    double res = 0;
+    auto end = time.data() + time.size();
+    return (!time.empty() && std::from_chars(time.data(), end, res).ptr == end) ? res : std::nan("");
+}
+
+/// Step logged at a given time, or nullptr if there is none. Steps are sorted by time, as the simulator logs them
+[[nodiscard]] time_step const *find_step(std::vector<time_step> const &steps, double time) {
+    auto it = std::lower_bound(steps.begin(), steps.end(), time, [](time_step const &step, double t) { return step.value < t; });
+    return (it != steps.end() && it->value == time) ? &*it : nullptr;
+}
+
+/// Sum of many doubles with Neumaier's compensation, so rounding errors do not pile up over billions of additions
+class compensated_sum {
+    double sum;
+    double compensation;
+
+public:
+    explicit compensated_sum(double initial = 0): sum(initial), compensation(0) {}
+
+    void add(double value) {
+        double t = sum + value;
+        compensation += (std::abs(sum) >= std::abs(value)) ? (sum - t) + value : (value - t) + sum;
+        sum = t;
+    }
+
+    [[nodiscard]] double value() const {
+        return sum + compensation;
+    }
+};
+
+/// Last four fields of a <population,phase,...> record are the total susceptible, infected, recovered and deceased ratios
+struct cell_record {
+    std::size_t cell;
+    unsigned int population;
+    unsigned int phase;
+    float susceptible;
+    float infected;
+    float recovered;
+    float deceased;
+};
+
+/// Aggregates of the whole lattice after applying the records of one time step
+struct step_aggregate {
+    std::string time;
+    double susceptible;
+    double infected;
+    double recovered;
+    double deceased;
+    double infected_population;
+    double deceased_population;
+};
+
+class log_reducer {
+    const char *data;
+    std::size_t size;
+    std::vector<int> shape;
+    unsigned int n_threads;
+
+    [[nodiscard]] static bool is_time_line(const char *begin, const char *end) {
+        if (begin == end) {
+            return false;
+        }
+        for (const char *c = begin; c < end; c++) {
+            if ((*c < '0' || *c > '9') && *c != '.' && *c != '\r') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] const char *line_end(const char *begin) const {
+        auto *end = static_cast<const char *>(std::memchr(begin, '\n', data + size - begin));
+        return (end == nullptr) ? data + size : end;
+    }
+
+    /// Runs task(i) for every i in [0, n) using all the reducer threads
+    template <typename F>
+    void parallel_for(std::size_t n, F const &task) const {
+        std::atomic<std::size_t> next(0);
+        auto worker = [&] {
+            for (std::size_t i = next++; i < n; i = next++) {
+                task(i);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (unsigned int t = 1; t < std::min<std::size_t>(n_threads, n); t++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread: threads) {
+            thread.join();
+        }
+    }
+
+    /// Returns the flat index of the cell (row-major order) or n_cells() if the position is out of the lattice
+    [[nodiscard]] std::size_t cell_index(const char *&c, const char *end) const {
+        std::size_t index = 0;
+        bool in_lattice = true;
+        for (int dim = 0; dim < (int) shape.size(); dim++) {
+            long coordinate = -1;
+            const char *next = std::from_chars(c, end, coordinate).ptr;
+            if (next == c || coordinate < 0 || coordinate >= shape[dim]) {
+                in_lattice = false;
+            }
+            index = index * shape[dim] + (std::size_t) coordinate;
+            c = std::find(next, end, (dim + 1 < (int) shape.size()) ? ',' : ')');
+            if (c == end) {
+                return n_cells();
+            }
+            c++;
+        }
+        return in_lattice ? index : n_cells();
+    }
+
+    [[nodiscard]] bool parse_record(const char *begin, const char *end, cell_record &record) const {
+        const char *c = std::search(begin, end, "{(", "{(" + 2);
+        if (c == end) {
+            return false;
+        }
+        c += 2;
+        record.cell = cell_index(c, end);
+        if (record.cell == n_cells()) {
+            return false;
+        }
+        c = std::find(c, end, '<');
+        const char *close = std::find(c, end, '>');
+        if (c == end || close == end) {
+            return false;
+        }
+        float head[2] = {0, 0};
+        float tail[4] = {0, 0, 0, 0};  // circular buffer with the last four fields
+        std::size_t n_fields = 0;
+        for (c++; c < close; c++) {
+            float field = 0;
+            const char *next = std::from_chars(c, close, field).ptr;  // never reads past the end of the record
+            if (n_fields < 2) {
+                head[n_fields] = field;
+            }
+            tail[n_fields++ % 4] = field;
+            c = std::find(next, close, ',');
+        }
+        if (n_fields < 6) {
+            return false;
+        }
+        record.population = (unsigned int) head[0];
+        record.phase = (unsigned int) head[1];
+        record.susceptible = tail[(n_fields - 4) % 4];
+        record.infected = tail[(n_fields - 3) % 4];
+        record.recovered = tail[(n_fields - 2) % 4];
+        record.deceased = tail[(n_fields - 1) % 4];
+        return true;
+    }
+
+public:
+    log_reducer(mapped_log const &log, std::vector<int> lattice_shape, unsigned int threads) :
+            data(log.data()), size(log.size()), shape(std::move(lattice_shape)), n_threads(std::max(threads, 1u)) {}
+
+    [[nodiscard]] std::size_t n_cells() const {
+        std::size_t n = 1;
+        for (int dim: shape) {
+            n *= dim;
+        }
+        return n;
+    }
+
+    /**
+     * Finds the time lines of the log. Each thread scans a slice of the file for the lines that start inside it.
+     * @return the byte range of every time step, in order of appearance.
+     */
+    [[nodiscard]] std::vector<time_step> index() const {
+        std::size_t n_slices = std::max<std::size_t>(1, std::min<std::size_t>(n_threads * 4, size >> 20));
+        std::vector<std::vector<std::size_t>> starts(n_slices);
+        parallel_for(n_slices, [&](std::size_t slice) {
+            std::size_t begin = size * slice / n_slices;
+            std::size_t end = size * (slice + 1) / n_slices;
+            const char *c = data + begin;
+            if (begin > 0 && data[begin - 1] != '\n') {
+                c = line_end(c) + 1;
+            }
+            while (c < data + end) {
+                const char *eol = line_end(c);
+                if (is_time_line(c, eol)) {
+                    starts[slice].push_back(c - data);
+                }
+                c = eol + 1;
+            }
+        });
+        std::vector<time_step> steps;
+        for (auto const &slice: starts) {
+            for (std::size_t offset: slice) {
+                if (!steps.empty()) {
+                    steps.back().length = offset - steps.back().offset;
+                }
+                const char *eol = line_end(data + offset);
+                std::string time(data + offset, eol);
+                if (!time.empty() && time.back() == '\r') {
+                    time.pop_back();
+                }
+                steps.push_back({time, offset, size - offset, parse_time(time)});
+            }
+        }
+        return steps;
+    }
+
+    /// Parses every cell record logged in a time step
+    [[nodiscard]] std::vector<cell_record> records(time_step const &step) const {
+        std::vector<cell_record> res;
+        const char *c = line_end(data + step.offset) + 1;
+        const char *end = data + step.offset + step.length;
+        while (c < end) {
+            const char *eol = line_end(c);
+            cell_record record{};
+            if (parse_record(c, eol, record)) {
+                res.push_back(record);
+            }
+            c = eol + 1;
+        }
+        return res;
+    }
+
+    /**
+     * Computes the lattice aggregates after every time step.
+     * Only cells that change are logged, so each cell keeps its last logged state.
+     * Cells that were never logged count as fully susceptible, as in automation/notebook.py.
+     * Unlike the notebook, the row of a time step includes the records of that time step (the notebook writes a row
+     * before applying them, and repeats its last time step with the final states).
+     * Steps are parsed in parallel in windows; states are then applied in order.
+     * @param steps time steps as returned by index().
+     * @return the aggregates of every time step.
+     */
+    [[nodiscard]] std::vector<step_aggregate> reduce(std::vector<time_step> const &steps) const {
+        std::size_t n = n_cells();
+        std::vector<cell_record> cells(n, cell_record{0, 0, 0, 1, 0, 0, 0});
+        compensated_sum susceptible((double) n), infected, recovered, deceased, infected_population, deceased_population;
+
+        std::vector<step_aggregate> res;
+        std::size_t window = n_threads * 16;
+        for (std::size_t first = 0; first < steps.size(); first += window) {
+            std::size_t last = std::min(first + window, steps.size());
+            std::vector<std::vector<cell_record>> parsed(last - first);
+            parallel_for(last - first, [&](std::size_t i) {
+                parsed[i] = records(steps[first + i]);
+            });
+            for (std::size_t i = 0; i < parsed.size(); i++) {
+                for (auto const &record: parsed[i]) {
+                    auto &old = cells[record.cell];
+                    susceptible.add(record.susceptible);
+                    susceptible.add(-old.susceptible);
+                    infected.add(record.infected);
+                    infected.add(-old.infected);
+                    recovered.add(record.recovered);
+                    recovered.add(-old.recovered);
+                    deceased.add(record.deceased);
+                    deceased.add(-old.deceased);
+                    infected_population.add((double) record.population * record.infected);
+                    infected_population.add(-(double) old.population * old.infected);
+                    deceased_population.add((double) record.population * record.deceased);
+                    deceased_population.add(-(double) old.population * old.deceased);
+                    old = record;
+                }
+                res.push_back({steps[first + i].time, susceptible.value() / n, infected.value() / n, recovered.value() / n,
+                               deceased.value() / n, infected_population.value(), deceased_population.value()});
+            }
+        }
+        return res;
+    }
+};
+
+/// Index files start with the size and modification time of their log, and then list one time step per line
+void write_index(std::string const &file_path, mapped_log const &log, std::vector<time_step> const &steps) {
+    std::ofstream out(file_path);
+    out << "log_size,log_modification_time\n" << log.size() << "," << log.modification_time() << "\n";
+    out << "time,offset,length\n";
+    for (auto const &step: steps) {
+        out << step.time << "," << step.offset << "," << step.length << "\n";
+    }
+}
+
+/**
+ * Reads the index of a log.
+ * @return the time steps of the index, or nothing if the index is missing, malformed, or does not match the log
+ * (e.g., the log was written again or truncated after indexing it).
+ */
+[[nodiscard]] std::vector<time_step> read_index(std::string const &file_path, mapped_log const &log) {
+    std::ifstream in(file_path);
+    std::string line;
+    std::getline(in, line);  // header of the log metadata
+    if (!std::getline(in, line) || line != std::to_string(log.size()) + "," + std::to_string(log.modification_time())) {
+        return {};
+    }
+    std::getline(in, line);  // header of the time steps
+    std::vector<time_step> steps;
+    while (std::getline(in, line)) {
+        auto first = line.find(',');
+        auto second = line.find(',', first + 1);
+        if (first == std::string::npos || second == std::string::npos) {
+            return {};
+        }
+        std::size_t offset = 0, length = 0;
+        auto offset_end = line.data() + second, length_end = line.data() + line.size();
+        if (std::from_chars(line.data() + first + 1, offset_end, offset).ptr != offset_end ||
+            std::from_chars(line.data() + second + 1, length_end, length).ptr != length_end ||
+            offset > log.size() || length > log.size() - offset) {
+            return {};
+        }
+        steps.push_back({line.substr(0, first), offset, length, parse_time(line.substr(0, first))});
+    }
+    return steps;
+}
+
+void write_aggregates(std::string const &file_path, std::vector<step_aggregate> const &aggregates) {
+    std::ofstream out(file_path);
+    out << "time,susceptible,infected,recovered,deceased,infected_population,deceased_population\n";
+    for (auto const &step: aggregates) {
+        out << step.time << "," << step.susceptible << "," << step.infected << "," << step.recovered << ","
+            << step.deceased << "," << step.infected_population << "," << step.deceased_population << "\n";
+    }
+}
+
+#endif //PANDEMIC_HOYA_2002_LOG_REDUCER_HPP
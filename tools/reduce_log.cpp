@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2020, Román Cárdenas Rodríguez
+ * ARSLab - Carleton University
+ * GreenLSI - Polytechnic University of Madrid
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include "log_reducer.hpp"
+
+using namespace std;
+
+int main(int argc, char ** argv) {
+    if (argc < 3) {
+        cout << "Program used with wrong parameters. The program must be invoked as follows:" << endl;
+        cout << argv[0] << " OUTPUT_MESSAGES.txt SHAPE (e.g., 25,25) [AGGREGATES_FILE (default: states.csv)] [THREADS]" << endl;
+        cout << argv[0] << " OUTPUT_MESSAGES.txt --frame TIME" << endl;
+        return -1;
+    }
+    std::string log_file_path = argv[1];
+    std::string index_file_path = log_file_path + ".index";
+    mapped_log log(log_file_path);
+
+    if (std::string(argv[2]) == "--frame") {
+        if (argc < 4) {
+            cout << "Missing time of the frame" << endl;
+            return -1;
+        }
+        std::vector<time_step> steps = read_index(index_file_path, log);
+        if (steps.empty()) {  // missing or stale index
+            steps = log_reducer(log, {}, std::thread::hardware_concurrency()).index();
+            write_index(index_file_path, log, steps);
+        }
+        time_step const *step = find_step(steps, parse_time(argv[3]));
+        if (step != nullptr) {
+            cout.write(log.data() + step->offset, (std::streamsize) step->length);
+            return 0;
+        }
+        cout << "Time " << argv[3] << " not found in " << log_file_path << endl;
+        return -1;
+    }
+
+    std::vector<int> shape;
+    std::stringstream dims(argv[2]);
+    for (std::string dim; std::getline(dims, dim, ',');) {
+        shape.push_back(std::stoi(dim));
+    }
+    std::string aggregates_file_path = (argc > 3)? argv[3] : "states.csv";
+    unsigned int threads = (argc > 4)? std::stoi(argv[4]) : std::thread::hardware_concurrency();
+
+    auto begin = std::chrono::steady_clock::now();
+    log_reducer reducer(log, shape, threads);
+    std::vector<time_step> steps = reducer.index();
+    write_index(index_file_path, log, steps);
+    write_aggregates(aggregates_file_path, reducer.reduce(steps));
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    cout << "Reduced " << steps.size() << " time steps (" << log.size() << " bytes) in " << elapsed.count() << " s" << endl;
+    return 0;
+}